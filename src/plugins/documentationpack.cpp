@@ -0,0 +1,568 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "documentationpack.h"
+#include "predefineddocumentationparser.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+
+namespace LuaEditor { namespace Internal {
+
+static const char g_packMagic[4] = { 'L', 'D', 'P', 'K' };
+static const char *const g_packSources[3] = { "/words", "/members", "/calls" };
+
+const DocumentationPack::Header DocumentationPack::s_emptyHeader = {};
+
+// deduplicates the strings of a pack while it's compiled
+class DocumentationStringTable
+{
+public:
+    DocumentationPack::StringRef add(const QString &string)
+    {
+        QByteArray utf8 = string.toUtf8();
+        auto it = m_refs.constFind(utf8);
+        if (it != m_refs.constEnd())
+            return it.value();
+
+        DocumentationPack::StringRef ref;
+        ref.offset = static_cast<quint32>(m_bytes.size());
+        ref.length = static_cast<quint32>(utf8.size());
+        m_bytes.append(utf8);
+        m_refs.insert(utf8, ref);
+        return ref;
+    }
+
+    bool lessThan(const DocumentationPack::StringRef &a, const DocumentationPack::StringRef &b) const
+    {
+        int result = std::memcmp(data(a), data(b), qMin(a.length, b.length));
+        return result < 0 || (result == 0 && a.length < b.length);
+    }
+
+    bool equals(const DocumentationPack::StringRef &a, const DocumentationPack::StringRef &b) const
+    {
+        return a.length == b.length && std::memcmp(data(a), data(b), a.length) == 0;
+    }
+
+    const char *data(const DocumentationPack::StringRef &ref) const
+    {
+        return m_bytes.constData() + ref.offset;
+    }
+
+    QByteArray m_bytes;
+
+private:
+    QHash<QByteArray, DocumentationPack::StringRef> m_refs;
+};
+
+// FNV-1a, the table layout must not depend on the Qt version or a hash seed
+static quint32 hashKey(const char *data, quint32 length)
+{
+    quint32 hash = 2166136261u;
+    for (quint32 i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<uchar>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// entries are (key, index) pairs, the table has a power of two size with at
+// least every second slot free, so probe sequences stay short
+static QVector<quint32> buildHashTable(const DocumentationStringTable &table, const QVector<QPair<DocumentationPack::StringRef, quint32>> &entries)
+{
+    if (entries.isEmpty())
+        return QVector<quint32>();
+
+    int size = 2;
+    while (size < entries.size() * 2)
+        size *= 2;
+
+    QVector<quint32> slots(size, 0);
+    for (const QPair<DocumentationPack::StringRef, quint32> &entry : entries)
+    {
+        quint32 slot = hashKey(table.data(entry.first), entry.first.length) & static_cast<quint32>(size - 1);
+        while (slots.at(static_cast<int>(slot)) != 0)
+            slot = (slot + 1) & static_cast<quint32>(size - 1);
+        slots[static_cast<int>(slot)] = entry.second + 1;
+    }
+    return slots;
+}
+
+// one entry per name, pointing to the first of its functions in the sorted index
+static QVector<quint32> buildFunctionHashTable(const DocumentationStringTable &table, const QVector<DocumentationPack::FunctionRecord> &functions,
+                                               const QVector<quint32> &sorted, DocumentationPack::StringRef DocumentationPack::FunctionRecord::*field)
+{
+    QVector<QPair<DocumentationPack::StringRef, quint32>> entries;
+    for (int i = 0; i < sorted.size(); ++i)
+    {
+        const DocumentationPack::StringRef &key = functions.at(static_cast<int>(sorted.at(i))).*field;
+        if (i == 0 || !table.equals(key, functions.at(static_cast<int>(sorted.at(i - 1))).*field))
+            entries.push_back(qMakePair(key, static_cast<quint32>(i)));
+    }
+    return buildHashTable(table, entries);
+}
+
+template<typename T>
+static DocumentationPack::Section appendSection(QByteArray &pack, const QVector<T> &items)
+{
+    // keep every section 8 byte aligned
+    while (pack.size() % 8)
+        pack.append('\0');
+
+    DocumentationPack::Section section;
+    section.offset = static_cast<quint32>(pack.size());
+    section.count = static_cast<quint32>(items.size());
+    if (!items.isEmpty())
+        pack.append(reinterpret_cast<const char *>(items.constData()), items.size() * static_cast<int>(sizeof(T)));
+    return section;
+}
+
+static QVector<DocumentationPack::StringRef> addStrings(DocumentationStringTable &table, const QStringList &strings)
+{
+    QVector<DocumentationPack::StringRef> refs;
+    refs.reserve(strings.size());
+    for (const QString &string : strings)
+        refs.push_back(table.add(string));
+    return refs;
+}
+
+static void sourceStamps(const QString &directory, qint64 sources[3][2])
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        QFileInfo info(directory + QString::fromLatin1(g_packSources[i]));
+        sources[i][0] = info.exists() ? info.size() : -1;
+        sources[i][1] = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+    }
+}
+
+DocumentationPack::DocumentationPack()
+    : m_map(nullptr),
+      m_data(nullptr),
+      m_size(0)
+{
+}
+
+DocumentationPack::~DocumentationPack()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+}
+
+QString DocumentationPack::cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QString::fromLatin1("/LuaEditor/completion.pack");
+}
+
+QByteArray DocumentationPack::compile(const QString &directory)
+{
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, g_packMagic, sizeof(g_packMagic));
+    header.version = Version;
+    // stamped before reading, so a change while compiling makes the pack stale
+    sourceStamps(directory, header.sources);
+
+    QStringList words;
+    QStringList members;
+    QMap<QString, QStringList> memberInfos;
+    QVector<PredefinedDocumentationParser::Call> calls;
+    PredefinedDocumentationParser::readWords(words, directory + QString::fromLatin1(g_packSources[0]));
+    PredefinedDocumentationParser::readMembers(members, memberInfos, directory + QString::fromLatin1(g_packSources[1]));
+    PredefinedDocumentationParser::readCalls(calls, directory + QString::fromLatin1(g_packSources[2]));
+
+    DocumentationStringTable table;
+    QVector<StringRef> wordRefs = addStrings(table, words);
+    QVector<StringRef> memberRefs = addStrings(table, members);
+
+    QVector<WordKey> wordKeys;
+    wordKeys.reserve(words.size());
+    for (int i = 0; i < words.size(); ++i)
+    {
+        WordKey wordKey;
+        wordKey.key = table.add(words.at(i).toLower());
+        wordKey.word = static_cast<quint32>(i);
+        wordKeys.push_back(wordKey);
+    }
+
+    QVector<StringRef> callRefs;
+    QVector<FunctionRecord> functionRecords;
+    QVector<StringRef> arguments;
+    for (const PredefinedDocumentationParser::Call &call : calls)
+    {
+        FunctionRecord record;
+        record.name = table.add(call.m_function.m_functionName);
+        record.shortName = table.add(call.m_shortName);
+        record.object = table.add(call.m_object);
+        record.returnType = table.add(call.m_function.m_returnType);
+        record.firstArgument = static_cast<quint32>(arguments.size());
+        record.argumentCount = static_cast<quint32>(call.m_function.m_arguments.size());
+        for (const QString &argument : call.m_function.m_arguments)
+            arguments.push_back(table.add(argument));
+
+        functionRecords.push_back(record);
+        callRefs.push_back(record.shortName);
+    }
+
+    QVector<MemberRecord> memberRecords;
+    QVector<StringRef> memberNames;
+    for (auto it = memberInfos.constBegin(); it != memberInfos.constEnd(); ++it)
+    {
+        MemberRecord record;
+        record.type = table.add(it.key());
+        record.firstMember = static_cast<quint32>(memberNames.size());
+        record.memberCount = static_cast<quint32>(it.value().size());
+        memberNames += addStrings(table, it.value());
+        memberRecords.push_back(record);
+    }
+
+    // lookups compare UTF-8 bytes, so that's the order of the sorted sections
+    std::sort(memberRecords.begin(), memberRecords.end(), [&table](const MemberRecord &a, const MemberRecord &b) {
+        return table.lessThan(a.type, b.type);
+    });
+    std::stable_sort(wordKeys.begin(), wordKeys.end(), [&table](const WordKey &a, const WordKey &b) {
+        return table.lessThan(a.key, b.key);
+    });
+
+    QVector<QPair<StringRef, quint32>> memberEntries;
+    for (int i = 0; i < memberRecords.size(); ++i)
+        memberEntries.push_back(qMakePair(memberRecords.at(i).type, static_cast<quint32>(i)));
+    QVector<quint32> memberHash = buildHashTable(table, memberEntries);
+
+    QVector<quint32> functionsByName(functionRecords.size());
+    QVector<quint32> functionsByObject(functionRecords.size());
+    for (int i = 0; i < functionRecords.size(); ++i)
+        functionsByName[i] = functionsByObject[i] = static_cast<quint32>(i);
+    // stable, so functions of the same name stay in file order
+    std::stable_sort(functionsByName.begin(), functionsByName.end(), [&](quint32 a, quint32 b) {
+        return table.lessThan(functionRecords.at(a).shortName, functionRecords.at(b).shortName);
+    });
+    std::stable_sort(functionsByObject.begin(), functionsByObject.end(), [&](quint32 a, quint32 b) {
+        return table.lessThan(functionRecords.at(a).object, functionRecords.at(b).object);
+    });
+    QVector<quint32> functionNameHash = buildFunctionHashTable(table, functionRecords, functionsByName, &FunctionRecord::shortName);
+    QVector<quint32> functionObjectHash = buildFunctionHashTable(table, functionRecords, functionsByObject, &FunctionRecord::object);
+
+    QByteArray pack(static_cast<int>(sizeof(Header)), '\0');
+    header.words = appendSection(pack, wordRefs);
+    header.members = appendSection(pack, memberRefs);
+    header.calls = appendSection(pack, callRefs);
+    header.memberRecords = appendSection(pack, memberRecords);
+    header.memberNames = appendSection(pack, memberNames);
+    header.functions = appendSection(pack, functionRecords);
+    header.arguments = appendSection(pack, arguments);
+    header.functionsByName = appendSection(pack, functionsByName);
+    header.functionsByObject = appendSection(pack, functionsByObject);
+    header.wordKeys = appendSection(pack, wordKeys);
+    header.memberHash = appendSection(pack, memberHash);
+    header.functionNameHash = appendSection(pack, functionNameHash);
+    header.functionObjectHash = appendSection(pack, functionObjectHash);
+
+    header.strings.offset = static_cast<quint32>(pack.size());
+    header.strings.count = static_cast<quint32>(table.m_bytes.size());
+    pack.append(table.m_bytes);
+
+    std::memcpy(pack.data(), &header, sizeof(header));
+    return pack;
+}
+
+bool DocumentationPack::load(const QString &directory, const QString &path)
+{
+    if (open(path) && isUpToDate(directory))
+        return true;
+
+    QByteArray pack = compile(directory);
+
+    // a mapped file can't be replaced everywhere
+    close();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)
+            && file.write(pack) == pack.size()
+            && file.commit()
+            && open(path)
+            && isUpToDate(directory))
+        return true;
+
+    // the cache directory isn't writable or the sources changed meanwhile
+    close();
+    m_buffer = pack;
+    return setData(m_buffer.constData(), m_buffer.size());
+}
+
+void DocumentationPack::close()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = nullptr;
+    m_file.close();
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool DocumentationPack::open(const QString &path)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_map = m_file.map(0, m_file.size());
+    if (m_map)
+        return setData(reinterpret_cast<const char *>(m_map), m_file.size());
+
+    m_buffer = m_file.readAll();
+    return setData(m_buffer.constData(), m_buffer.size());
+}
+
+bool DocumentationPack::setData(const char *data, qint64 size)
+{
+    m_data = data;
+    m_size = size;
+    if (isValid())
+        return true;
+
+    m_data = nullptr;
+    m_size = 0;
+    return false;
+}
+
+bool DocumentationPack::isValid() const
+{
+    if (!m_data || m_size < static_cast<qint64>(sizeof(Header)) || m_size > 0x7fffffff)
+        return false;
+
+    const Header *h = header();
+    if (std::memcmp(h->magic, g_packMagic, sizeof(g_packMagic)) != 0 || h->version != Version)
+        return false;
+
+    auto sectionFits = [this](const Section &section, size_t itemSize) {
+        return section.offset % 8 == 0
+                && static_cast<qint64>(section.offset) + static_cast<qint64>(section.count) * static_cast<qint64>(itemSize) <= m_size;
+    };
+    if (!(static_cast<qint64>(h->strings.offset) + h->strings.count <= m_size
+            && sectionFits(h->words, sizeof(StringRef))
+            && sectionFits(h->members, sizeof(StringRef))
+            && sectionFits(h->calls, sizeof(StringRef))
+            && sectionFits(h->memberRecords, sizeof(MemberRecord))
+            && sectionFits(h->memberNames, sizeof(StringRef))
+            && sectionFits(h->functions, sizeof(FunctionRecord))
+            && sectionFits(h->arguments, sizeof(StringRef))
+            && sectionFits(h->functionsByName, sizeof(quint32))
+            && sectionFits(h->functionsByObject, sizeof(quint32))
+            && sectionFits(h->wordKeys, sizeof(WordKey))
+            && sectionFits(h->memberHash, sizeof(quint32))
+            && sectionFits(h->functionNameHash, sizeof(quint32))
+            && sectionFits(h->functionObjectHash, sizeof(quint32))))
+        return false;
+
+    // every reference is checked once here, so lookups don't have to
+    auto refFits = [h](const StringRef &ref) {
+        return static_cast<quint64>(ref.offset) + ref.length <= h->strings.count;
+    };
+    auto refsFit = [this, &refFits](const Section &section) {
+        const StringRef *refs = stringRefs(section);
+        return std::all_of(refs, refs + section.count, refFits);
+    };
+    if (!(refsFit(h->words) && refsFit(h->members) && refsFit(h->calls) && refsFit(h->memberNames) && refsFit(h->arguments)))
+        return false;
+
+    const MemberRecord *memberRecords = array<MemberRecord>(h->memberRecords);
+    for (quint32 i = 0; i < h->memberRecords.count; ++i)
+    {
+        const MemberRecord &record = memberRecords[i];
+        if (!refFits(record.type) || static_cast<quint64>(record.firstMember) + record.memberCount > h->memberNames.count)
+            return false;
+    }
+
+    const FunctionRecord *functions = array<FunctionRecord>(h->functions);
+    for (quint32 i = 0; i < h->functions.count; ++i)
+    {
+        const FunctionRecord &record = functions[i];
+        if (!refFits(record.name) || !refFits(record.shortName) || !refFits(record.object) || !refFits(record.returnType)
+                || static_cast<quint64>(record.firstArgument) + record.argumentCount > h->arguments.count)
+            return false;
+    }
+
+    auto indicesFit = [this, h](const Section &section) {
+        const quint32 *indices = array<quint32>(section);
+        return section.count == h->functions.count
+                && std::all_of(indices, indices + section.count, [h](quint32 index) { return index < h->functions.count; });
+    };
+    if (!indicesFit(h->functionsByName) || !indicesFit(h->functionsByObject))
+        return false;
+
+    const WordKey *wordKeys = array<WordKey>(h->wordKeys);
+    if (h->wordKeys.count != h->words.count
+            || !std::all_of(wordKeys, wordKeys + h->wordKeys.count, [&](const WordKey &key) { return refFits(key.key) && key.word < h->words.count; }))
+        return false;
+
+    // lookups mask the hash, so the tables need a power of two size
+    auto hashFits = [this](const Section &section, quint32 count) {
+        const quint32 *slots = array<quint32>(section);
+        return (section.count & (section.count - 1)) == 0
+                && std::all_of(slots, slots + section.count, [count](quint32 slot) { return slot <= count; });
+    };
+    return hashFits(h->memberHash, h->memberRecords.count)
+            && hashFits(h->functionNameHash, h->functions.count)
+            && hashFits(h->functionObjectHash, h->functions.count);
+}
+
+bool DocumentationPack::isUpToDate(const QString &directory) const
+{
+    qint64 sources[3][2];
+    sourceStamps(directory, sources);
+    return std::memcmp(sources, header()->sources, sizeof(sources)) == 0;
+}
+
+QStringList DocumentationPack::strings(const Section &section) const
+{
+    const StringRef *refs = stringRefs(section);
+
+    QStringList result;
+    result.reserve(static_cast<int>(section.count));
+    for (quint32 i = 0; i < section.count; ++i)
+        result.push_back(string(refs[i]));
+    return result;
+}
+
+int DocumentationPack::compare(const StringRef &ref, const QByteArray &key) const
+{
+    size_t keyLength = static_cast<size_t>(key.size());
+    int result = std::memcmp(bytes(ref), key.constData(), qMin<size_t>(ref.length, keyLength));
+    if (result != 0)
+        return result;
+    return ref.length < keyLength ? -1 : (ref.length > keyLength ? 1 : 0);
+}
+
+int DocumentationPack::comparePrefix(const StringRef &ref, const QByteArray &key) const
+{
+    size_t keyLength = static_cast<size_t>(key.size());
+    int result = std::memcmp(bytes(ref), key.constData(), qMin<size_t>(ref.length, keyLength));
+    if (result != 0)
+        return result;
+    return ref.length < keyLength ? -1 : 0;
+}
+
+template<typename KeyAt>
+qint64 DocumentationPack::findInHash(const Section &hash, const QByteArray &key, KeyAt keyAt) const
+{
+    if (hash.count == 0)
+        return -1;
+
+    const quint32 *slots = array<quint32>(hash);
+    quint32 mask = hash.count - 1;
+    quint32 slot = hashKey(key.constData(), static_cast<quint32>(key.size())) & mask;
+    // at least half of the slots are empty, a broken pack just ends the probe
+    for (quint32 probes = 0; probes < hash.count && slots[slot] != 0; ++probes)
+    {
+        quint32 index = slots[slot] - 1;
+        if (compare(keyAt(index), key) == 0)
+            return index;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+QStringList DocumentationPack::wordsStartingWith(const QString &prefix) const
+{
+    QByteArray key = prefix.toLower().toUtf8();
+    const WordKey *begin = array<WordKey>(header()->wordKeys);
+    const WordKey *end = begin + header()->wordKeys.count;
+
+    // the lowercased words starting with key are one range of the sorted keys
+    const WordKey *first = std::lower_bound(begin, end, key, [this](const WordKey &wordKey, const QByteArray &key) {
+        return compare(wordKey.key, key) < 0;
+    });
+    const WordKey *last = std::upper_bound(first, end, key, [this](const QByteArray &key, const WordKey &wordKey) {
+        return comparePrefix(wordKey.key, key) > 0;
+    });
+
+    const StringRef *words = stringRefs(header()->words);
+    QStringList result;
+    result.reserve(static_cast<int>(last - first));
+    for (const WordKey *it = first; it != last; ++it)
+        result.push_back(string(words[it->word]));
+    return result;
+}
+
+QStringList DocumentationPack::memberInfos(const QString &type) const
+{
+    const MemberRecord *records = array<MemberRecord>(header()->memberRecords);
+    qint64 index = findInHash(header()->memberHash, type.toUtf8(), [records](quint32 index) { return records[index].type; });
+    if (index < 0)
+        return QStringList();
+
+    const MemberRecord &record = records[index];
+    const StringRef *names = stringRefs(header()->memberNames) + record.firstMember;
+    QStringList result;
+    result.reserve(static_cast<int>(record.memberCount));
+    for (quint32 i = 0; i < record.memberCount; ++i)
+        result.push_back(string(names[i]));
+    return result;
+}
+
+DocumentationPack::Function DocumentationPack::function(quint32 index, bool fullName) const
+{
+    const FunctionRecord &record = array<FunctionRecord>(header()->functions)[index];
+    const StringRef *arguments = stringRefs(header()->arguments) + record.firstArgument;
+
+    Function result;
+    result.m_functionName = string(fullName ? record.name : record.shortName);
+    result.m_returnType = string(record.returnType);
+    result.m_arguments.reserve(static_cast<int>(record.argumentCount));
+    for (quint32 i = 0; i < record.argumentCount; ++i)
+        result.m_arguments.push_back(string(arguments[i]));
+    return result;
+}
+
+QVector<DocumentationPack::Function> DocumentationPack::functions(const Section &index, const Section &hash, const QString &key, StringRef FunctionRecord::*field, bool fullName) const
+{
+    QByteArray utf8 = key.toUtf8();
+    const FunctionRecord *records = array<FunctionRecord>(header()->functions);
+    const quint32 *sorted = array<quint32>(index);
+
+    qint64 first = findInHash(hash, utf8, [records, sorted, field](quint32 position) { return records[sorted[position]].*field; });
+    if (first < 0)
+        return QVector<Function>();
+
+    // the functions with that name follow the first one in the sorted index
+    QVector<Function> result;
+    for (quint32 position = static_cast<quint32>(first); position < index.count && compare(records[sorted[position]].*field, utf8) == 0; ++position)
+        result.push_back(function(sorted[position], fullName));
+    return result;
+}
+
+QVector<DocumentationPack::Function> DocumentationPack::functionsByFunction(const QString &name) const
+{
+    return functions(header()->functionsByName, header()->functionNameHash, name, &FunctionRecord::shortName, true);
+}
+
+QVector<DocumentationPack::Function> DocumentationPack::functionsByObject(const QString &object) const
+{
+    return functions(header()->functionsByObject, header()->functionObjectHash, object, &FunctionRecord::object, false);
+}
+
+} }
@@ -0,0 +1,163 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUAEDITORDOCUMENTATIONPACK_H
+#define LUAEDITORDOCUMENTATIONPACK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "luafunctionhintproposalmodel.h"
+
+namespace LuaEditor { namespace Internal {
+
+// The completion documentation compiled into one flat buffer: a string table
+// of UTF-8 bytes, the word lists as string references and the member and
+// function records sorted by name, with hash tables over the names and the
+// lowercased words sorted for prefix searches, so nothing has to be parsed.
+// Packs are written to the cache directory and memory mapped, so Qt Creator
+// instances share the pages. The layout uses the native byte order, a pack
+// is only read on the machine that compiled it.
+class DocumentationPack
+{
+    DocumentationPack(const DocumentationPack &) = delete;
+    DocumentationPack &operator=(const DocumentationPack &) = delete;
+
+public:
+    typedef LuaFunctionHintProposalModel::Function Function;
+
+    struct StringRef
+    {
+        quint32 offset;
+        quint32 length;
+    };
+
+    struct Section
+    {
+        quint32 offset;
+        quint32 count;
+    };
+
+    struct MemberRecord
+    {
+        StringRef type;
+        quint32 firstMember;
+        quint32 memberCount;
+    };
+
+    struct FunctionRecord
+    {
+        StringRef name;
+        StringRef shortName;
+        StringRef object;
+        StringRef returnType;
+        quint32 firstArgument;
+        quint32 argumentCount;
+    };
+
+    // a lowercased word, sorted by key
+    struct WordKey
+    {
+        StringRef key;
+        quint32 word;
+    };
+
+    struct Header
+    {
+        char magic[4];
+        quint32 version;
+        // size and modification time of the words, members and calls files
+        qint64 sources[3][2];
+        Section strings;
+        Section words;
+        Section members;
+        Section calls;
+        Section memberRecords;
+        Section memberNames;
+        Section functions;
+        Section arguments;
+        Section functionsByName;
+        Section functionsByObject;
+        Section wordKeys;
+        // open addressing tables of index + 1, 0 for an empty slot
+        Section memberHash;
+        Section functionNameHash;
+        Section functionObjectHash;
+    };
+
+    enum { Version = 2 };
+
+    DocumentationPack();
+    ~DocumentationPack();
+
+    // the pack of the text files in directory, compiled into path first if
+    // it's missing or out of date; kept in memory if it can't be written
+    bool load(const QString &directory, const QString &path);
+
+    static QByteArray compile(const QString &directory);
+    static QString cachePath();
+
+    QStringList words() const { return strings(header()->words); }
+    QStringList members() const { return strings(header()->members); }
+    QStringList calls() const { return strings(header()->calls); }
+
+    // words starting with prefix, ignoring case
+    QStringList wordsStartingWith(const QString &prefix) const;
+
+    QStringList memberInfos(const QString &type) const;
+    // functions named name, with their full name including the object
+    QVector<Function> functionsByFunction(const QString &name) const;
+    // functions of object, with their name without the object
+    QVector<Function> functionsByObject(const QString &object) const;
+
+private:
+    void close();
+    bool open(const QString &path);
+    bool setData(const char *data, qint64 size);
+    bool isValid() const;
+    bool isUpToDate(const QString &directory) const;
+
+    // an empty header when nothing is loaded, every section of it is empty
+    const Header *header() const { return m_data ? reinterpret_cast<const Header *>(m_data) : &s_emptyHeader; }
+    template<typename T>
+    const T *array(const Section &section) const { return reinterpret_cast<const T *>(m_data + section.offset); }
+    const StringRef *stringRefs(const Section &section) const { return array<StringRef>(section); }
+
+    const char *bytes(const StringRef &ref) const { return m_data + header()->strings.offset + ref.offset; }
+    QString string(const StringRef &ref) const { return QString::fromUtf8(bytes(ref), static_cast<int>(ref.length)); }
+    QStringList strings(const Section &section) const;
+    int compare(const StringRef &ref, const QByteArray &key) const;
+    // like compare(), but ref only has to start with key
+    int comparePrefix(const StringRef &ref, const QByteArray &key) const;
+    // the index stored for key in the hash table, -1 if there is none
+    template<typename KeyAt>
+    qint64 findInHash(const Section &hash, const QByteArray &key, KeyAt keyAt) const;
+    Function function(quint32 index, bool fullName) const;
+    QVector<Function> functions(const Section &index, const Section &hash, const QString &key, StringRef FunctionRecord::*field, bool fullName) const;
+
+    static const Header s_emptyHeader;
+
+    QFile m_file;
+    uchar *m_map;
+    QByteArray m_buffer;
+    const char *m_data;
+    qint64 m_size;
+};
+
+} }
+
+#endif
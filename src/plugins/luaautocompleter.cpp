@@ -13,20 +13,21 @@
 */
 
 #include "luaautocompleter.h"
-#include "scanner/luascanner.h"
+#include "scanner/luablockdata.h"
 
 namespace LuaEditor { namespace Internal {
 
 LuaAutoCompleter::LuaAutoCompleter() {}
 LuaAutoCompleter::~LuaAutoCompleter() {}
 
+static Scanner::TokType tokenTypeAtCursor(const QTextCursor &cursor)
+{
+	return LuaBlockData::get(cursor.block())->tokenTypeAt(cursor.positionInBlock());
+}
+
 bool LuaAutoCompleter::contextAllowsAutoParentheses(const QTextCursor &cursor, const QString &) const
 {
-	QString blockText = cursor.block().text();
-	Scanner scanner(blockText.constData(),blockText.size());
-	scanner.setState(Scanner::TakeBackwardsState(cursor.block().previous()));
-	Scanner::TokType tt = scanner.tokenTypeAt(cursor.positionInBlock());
-	return (tt == Scanner::TT_Code);
+	return (tokenTypeAtCursor(cursor) == Scanner::TT_Code);
 }
 
 bool LuaAutoCompleter::contextAllowsElectricCharacters(const QTextCursor &cursor) const
@@ -36,21 +37,11 @@ bool LuaAutoCompleter::contextAllowsElectricCharacters(const QTextCursor &cursor
 
 bool LuaAutoCompleter::isInString(const QTextCursor &cursor) const
 {
-	QString blockText = cursor.block().text();
-	Scanner scanner(blockText.constData(),blockText.size());
-	scanner.setState(Scanner::TakeBackwardsState(cursor.block().previous()));
-	Scanner::TokType tt = scanner.tokenTypeAt(cursor.positionInBlock());
-	
-	return (tt == Scanner::TT_String);
+	return (tokenTypeAtCursor(cursor) == Scanner::TT_String);
 }
 bool LuaAutoCompleter::isInComment(const QTextCursor &cursor) const
 {
-	QString blockText = cursor.block().text();
-	Scanner scanner(blockText.constData(),blockText.size());
-	scanner.setState(Scanner::TakeBackwardsState(cursor.block().previous()));
-	Scanner::TokType tt = scanner.tokenTypeAt(cursor.positionInBlock());
-	
-	return (tt == Scanner::TT_Comment);
+	return (tokenTypeAtCursor(cursor) == Scanner::TT_Comment);
 }
 
 } }
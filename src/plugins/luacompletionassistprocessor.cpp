@@ -16,9 +16,10 @@
 #include "luafunctionhintproposalmodel.h"
 #include "luafunctionfilter.h"
 #include "predefineddocumentationparser.h"
+#include "luadocumentsymbols.h"
+#include "scanner/luablockdata.h"
 #include "scanner/luascanner.h"
 #include <texteditor/codeassist/assistinterface.h>
-#include <texteditor/codeassist/assistproposalitem.h>
 #include <texteditor/codeassist/genericproposal.h>
 #include <QTextCursor>
 #include <QTextDocument>
@@ -27,6 +28,8 @@
 #include <QDir>
 #include <QByteArray>
 
+#include <utils/runextensions.h>
+
 #include <iostream>
 
 #include <texteditor/codeassist/functionhintproposal.h>
@@ -94,29 +97,34 @@ static QStringList const g_magics = {
 	QStringLiteral("__unm")
 };
 
+// The candidates of the last content request, all processors share it as
+// a new processor is created for every completion. Typing on at the end of
+// a word only narrows them: every source filters by the word as a prefix
+// and duplicates keep their first occurrence, so filtering the candidates
+// by the longer word gives exactly what a new request would. Only used on
+// the GUI thread.
+struct CompletionCache
+{
+    LuaCompletionAssistProcessor::CacheKey m_key;
+    QVector<LuaCompletionAssistProcessor::Completion> m_completions;
+};
+
+static CompletionCache g_completionCache;
+
 LuaCompletionAssistProcessor::LuaCompletionAssistProcessor()
-	: m_startPosition(0),
-	  m_varIcon(QLatin1String(":/LuaEditor/images/var.png")),
+	: m_varIcon(QLatin1String(":/LuaEditor/images/var.png")),
 	  m_functionIcon(QLatin1String(":/LuaEditor/images/func.png")),
 	  m_memIcon(QLatin1String(":/LuaEditor/images/attributes.png")),
-      m_keywordIcon(QLatin1String(":/LuaEditor/images/keyword.png"))
+      m_keywordIcon(QLatin1String(":/LuaEditor/images/keyword.png")),
+      m_documentation(PredefinedDocumentation::instance())
 {
-    PredefinedDocumentationParser::readWords(predefinedWords, QDir::homePath() + QString::fromLatin1("/.avorion/documentation/completion/words"));
-    PredefinedDocumentationParser::readMembers(predefinedMembers, predefinedMemberInfos, QDir::homePath() + QString::fromLatin1("/.avorion/documentation/completion/members"));
-    PredefinedDocumentationParser::readCalls(predefinedCalls, predefinedFunctionInfosByFunction, predefinedFunctionInfosByObject, QDir::homePath() + QString::fromLatin1("/.avorion/documentation/completion/calls"));
+    QObject::connect(&m_watcher, &QFutureWatcherBase::finished, &m_watcher, [this]() { resultReady(); });
 }
 
 LuaCompletionAssistProcessor::~LuaCompletionAssistProcessor()
 {
-}
-
-static TextEditor::AssistProposalItem* createCompletionItem(QString const& text, QIcon const& icon, int order =0)
-{
-	TextEditor::AssistProposalItem* item = new TextEditor::AssistProposalItem;
-    item->setText(text);
-    item->setIcon(icon);
-    item->setOrder(order);
-	return item;
+    // the worker only holds its own request, let it run out
+    m_watcher.cancel();
 }
 
 struct PriorityList {
@@ -131,128 +139,250 @@ struct PriorityList {
 
 TextEditor::IAssistProposal* LuaCompletionAssistProcessor::perform(const TextEditor::AssistInterface *interface)
 {
-    if (TextEditor::IAssistProposal *proposal = tryCreateFunctionHintProposal(interface))
-        return proposal;
+    // the processor owns the interface
+    Request request;
+    request.m_interface.reset(const_cast<TextEditor::AssistInterface *>(interface));
+    request.m_documentation = m_documentation;
+
+    if (interface->reason() == TextEditor::IdleEditor && !acceptsIdleEditor())
+        return nullptr;
+
+    request.m_context = detectContext(interface);
+    m_document = interface->textDocument();
+    DocumentSymbols *symbols = DocumentSymbols::forDocument(interface->textDocument());
 
-    return createContentProposal(interface);
+    // function hints aren't cached, they depend on the whole argument list
+    if (!request.m_context.m_isFunctionCall)
+    {
+        m_cacheKey.m_document = interface->textDocument();
+        m_cacheKey.m_fileName = interface->fileName();
+        m_cacheKey.m_generation = symbols->generation();
+        m_cacheKey.m_documentationRevision = m_documentation->m_revision;
+        m_cacheKey.m_context = request.m_context;
+
+        if (TextEditor::IAssistProposal *proposal = narrowCachedProposal(m_cacheKey))
+            return proposal;
+    }
+    else
+    {
+        m_cacheKey = CacheKey();
+    }
+
+    // the scope index of the blocks is only up to date on the GUI thread
+    if (!request.m_context.m_isMemberCompletion && !request.m_context.m_isFunctionCompletion)
+    {
+        int position = request.m_context.m_isWordCompletion ? request.m_context.m_startPosition : interface->position();
+        request.m_visibleNames = LuaBlockData::visibleNames(interface->textDocument(), position);
+    }
+    else
+    {
+        // the blocks keep their chains, the worker would have to scan its
+        // copy of the document for them
+        QTextBlock cursorBlock = interface->textDocument()->findBlock(interface->position());
+        int state = 0;
+        for (QTextBlock block = interface->textDocument()->firstBlock(); block.isValid() && block != cursorBlock; block = block.next())
+        {
+            LuaBlockData const *data = LuaBlockData::get(block, state);
+            request.m_identifierChains += data->m_identifiers;
+            state = data->m_endState;
+        }
+    }
+
+    // the functions of the live document, not of the file on disk
+    FunctionParser::FunctionList dependencies;
+    request.m_hasDependencies = symbols->dependencyFunctions(interface->fileName(), dependencies);
+    request.m_functions = symbols->functions();
+    request.m_functions.append(dependencies);
+
+    // copies the text and block states, the worker builds its own document from them
+    request.m_interface->prepareForAsyncUse();
+    m_watcher.setFuture(Utils::runAsync(&LuaCompletionAssistProcessor::run, request));
+    return nullptr;
 }
 
-TextEditor::IAssistProposal *LuaCompletionAssistProcessor::tryCreateFunctionHintProposal(const TextEditor::AssistInterface *interface)
+bool LuaCompletionAssistProcessor::running()
 {
-    int pos = interface->position() - 1;
-    QChar ch = interface->characterAt(pos);
+    return m_watcher.isRunning();
+}
+
+void LuaCompletionAssistProcessor::cancel()
+{
+    m_watcher.cancel();
+}
+
+void LuaCompletionAssistProcessor::run(QFutureInterface<Result> &future, Request request)
+{
+    request.m_interface->recreateTextDocument();
 
-    while (ch.isSpace())
+    // only until the document's dependencies are loaded in the background
+    if (!request.m_hasDependencies)
+        request.m_functions.append(FunctionParser::parseDependencyFunctions(request.m_interface->fileName()));
+
+    Result result;
+    if (!request.m_context.m_isFunctionCall || !tryCreateFunctionHint(request, result))
+        createContent(future, request, result);
+
+    if (!future.isCanceled())
+        future.reportResult(result);
+}
+
+void LuaCompletionAssistProcessor::resultReady()
+{
+    if (m_watcher.isCanceled() || m_watcher.future().resultCount() == 0)
+        return;
+
+    Result result = m_watcher.result();
+    if (!result.m_isFunctionHint && m_cacheKey.m_document)
     {
-        ch = interface->characterAt(--pos);
+        g_completionCache.m_key = m_cacheKey;
+        g_completionCache.m_completions = result.m_completions;
     }
 
-    if (ch != QChar(',') && ch != QChar('('))
+    setAsyncProposalAvailable(createProposal(result));
+}
+
+TextEditor::IAssistProposal *LuaCompletionAssistProcessor::narrowCachedProposal(const CacheKey &key) const
+{
+    const CacheKey &cached = g_completionCache.m_key;
+    if (!cached.m_document
+            || cached.m_document != key.m_document
+            || cached.m_fileName != key.m_fileName
+            || cached.m_generation != key.m_generation
+            || cached.m_documentationRevision != key.m_documentationRevision
+            || cached.m_context.m_startPosition != key.m_context.m_startPosition
+            || cached.m_context.m_isMemberCompletion != key.m_context.m_isMemberCompletion
+            || cached.m_context.m_isFunctionCompletion != key.m_context.m_isFunctionCompletion
+            || cached.m_context.m_isWordCompletion != key.m_context.m_isWordCompletion)
         return nullptr;
 
+    const QString &prefix = key.m_context.m_currentMember;
+    Result result;
+    result.m_startPosition = key.m_context.m_startPosition;
+
+    if (key.m_context.m_isWordCompletion)
+    {
+        // only a longer word narrows, anything else needs new candidates
+        if (!prefix.startsWith(cached.m_context.m_currentMember))
+            return nullptr;
+
+        for (const Completion &completion : g_completionCache.m_completions)
+        {
+            if (completion.m_text.startsWith(prefix, Qt::CaseInsensitive))
+                result.m_completions.push_back(completion);
+        }
+
+        g_completionCache.m_key = key;
+        g_completionCache.m_completions = result.m_completions;
+    }
+    else
+    {
+        if (prefix != cached.m_context.m_currentMember)
+            return nullptr;
+
+        result.m_completions = g_completionCache.m_completions;
+    }
+
+    return createProposal(result);
+}
+
+TextEditor::IAssistProposal *LuaCompletionAssistProcessor::createProposal(const Result &result) const
+{
+    if (result.m_isFunctionHint)
+    {
+        TextEditor::FunctionHintProposalModelPtr model(new LuaFunctionHintProposalModel(QVector<Function>(result.m_functions), m_document, result.m_startPosition, result.m_callPosition));
+        return new TextEditor::FunctionHintProposal(result.m_startPosition, model);
+    }
+
+    const QIcon icons[LuaCompletionProposalModel::IconCount] = {m_varIcon, m_functionIcon, m_memIcon, m_keywordIcon};
+    TextEditor::GenericProposalModelPtr model(new LuaCompletionProposalModel(QVector<Completion>(result.m_completions), icons));
+    return new TextEditor::GenericProposal(result.m_startPosition, model);
+}
+
+bool LuaCompletionAssistProcessor::tryCreateFunctionHint(const Request &request, Result &result)
+{
+    const TextEditor::AssistInterface *interface = request.m_interface.data();
+    const Context &context = request.m_context;
+
+    if (!context.m_isFunctionCall || context.m_callPosition < 0)
+        return false;
+
     QString functionName;
     bool isParameterList = false;
-    int beginningOfFunctionName = pos;
+    int beginningOfFunctionName = context.m_position;
 
-    // check if we're inside a function parameter list
-    // walk backwards, count parentheses
+    // walk backwards from the parenthesis opening the parameter list
     {
-        int p = pos;
-        int parentheses = 0;
-        int brackets = 0;
-        int curly = 0;
+        int p = context.m_callPosition - 1;
+
+        // we're now outside the parameter list
+        // characters that are okay now are: . : spaces letters and numbers
+        bool lastWasWord = false;
+        QVector<QString> words;
+        QString currentWord;
 
         while (p >= 0)
         {
             QChar c = interface->characterAt(p);
-
-            if (c == QChar(')')) parentheses++;
-            else if (c == QChar('(')) parentheses--;
-            else if (c == QChar(']')) brackets++;
-            else if (c == QChar('[')) brackets--;
-            else if (c == QChar('}')) curly++;
-            else if (c == QChar('{')) curly--;
-
             p--;
 
-            if (curly == 0 && brackets == 0 && parentheses == -1)
+            // everything else cancels
+            if (!(c.isSpace() || c.isLetterOrNumber()
+                    || c == QChar('_')
+                    || c == QChar('.')
+                    || c == QChar(':')))
             {
+                // push what we collected so far
+                if (words.isEmpty()) beginningOfFunctionName = p + 1;
+                words.push_back(currentWord);
                 break;
             }
-        }
-
-        if (curly == 0 && brackets == 0 && parentheses == -1)
-        {
-            // we're now outside the parameter list
-            // characters that are okay now are: . : spaces letters and numbers
-            bool lastWasWord = false;
-            QVector<QString> words;
-            QString currentWord;
 
-            while (p >= 0)
+            // whitespace indicates end of a word
+            if (c.isSpace())
             {
-                QChar c = interface->characterAt(p);
-                p--;
-
-                // everything else cancels
-                if (!(c.isSpace() || c.isLetterOrNumber()
-                        || c == QChar('_')
-                        || c == QChar('.')
-                        || c == QChar(':')))
+                if (!currentWord.isEmpty())
                 {
-                    // push what we collected so far
                     if (words.isEmpty()) beginningOfFunctionName = p + 1;
                     words.push_back(currentWord);
-                    break;
-                }
+                    currentWord.clear();
 
-                // whitespace indicates end of a word
-                if (c.isSpace())
-                {
-                    if (!currentWord.isEmpty())
-                    {
-                        if (words.isEmpty()) beginningOfFunctionName = p + 1;
-                        words.push_back(currentWord);
-                        currentWord.clear();
-
-                        if (lastWasWord) break;
-                        lastWasWord = true;
-                    }
-
-                    // apart from ending words, skip whitespaces
-                    continue;
+                    if (lastWasWord) break;
+                    lastWasWord = true;
                 }
 
-                if (c.isLetterOrNumber() || c == QChar('_'))
-                {
-                    currentWord.prepend(c);
-                }
-                else
-                {
-                    // separators end words as well
-                    if (!currentWord.isEmpty())
-                    {
-                        if (words.isEmpty()) beginningOfFunctionName = p + 1;
-                        words.push_back(currentWord);
-                        currentWord.clear();
-
-                        if (lastWasWord) break;
-                        lastWasWord = true;
-                    }
-
-                    if (!lastWasWord) break;
-                    lastWasWord = false;
-                }
+                // apart from ending words, skip whitespaces
+                continue;
             }
 
-            // if the first or last word is "function" we're inside a function declaration parameter list
-            if (!words.isEmpty()
-                    && words.front() != QString("function")
-                    && words.back() != QString("function"))
+            if (c.isLetterOrNumber() || c == QChar('_'))
             {
-                functionName = words.front();
-                isParameterList = true;
+                currentWord.prepend(c);
             }
+            else
+            {
+                // separators end words as well
+                if (!currentWord.isEmpty())
+                {
+                    if (words.isEmpty()) beginningOfFunctionName = p + 1;
+                    words.push_back(currentWord);
+                    currentWord.clear();
+
+                    if (lastWasWord) break;
+                    lastWasWord = true;
+                }
+
+                if (!lastWasWord) break;
+                lastWasWord = false;
+            }
+        }
+
+        // if the first or last word is "function" we're inside a function declaration parameter list
+        if (!words.isEmpty()
+                && words.front() != QString("function")
+                && words.back() != QString("function"))
+        {
+            functionName = words.front();
+            isParameterList = true;
         }
     }
 
@@ -260,8 +390,7 @@ TextEditor::IAssistProposal *LuaCompletionAssistProcessor::tryCreateFunctionHint
     {
         QVector<LuaFunctionHintProposalModel::Function> functions;
 
-        QList<QSharedPointer<FunctionParser::Function>> parsedFunctions = FunctionParser::parseFunctionsInFile(interface->fileName());
-        for (QSharedPointer<FunctionParser::Function> &parsedFunction : parsedFunctions)
+        for (const QSharedPointer<FunctionParser::Function> &parsedFunction : request.m_functions)
         {
             if (parsedFunction->functionName == functionName)
             {
@@ -288,28 +417,21 @@ TextEditor::IAssistProposal *LuaCompletionAssistProcessor::tryCreateFunctionHint
         }
 
         // check all predefined functions
-        auto it = predefinedFunctionInfosByFunction.find(functionName);
-        if (it != predefinedFunctionInfosByFunction.end())
-        {
-            for (const Function &function : *it)
-            {
-                functions.push_back(function);
-            }
-        }
-
-        TextEditor::FunctionHintProposalModelPtr model(new LuaFunctionHintProposalModel(std::move(functions)));
+        functions += request.m_documentation->m_pack.functionsByFunction(functionName);
 
-        return new TextEditor::FunctionHintProposal(beginningOfFunctionName + 1, model);
+        result.m_isFunctionHint = true;
+        result.m_startPosition = beginningOfFunctionName + 1;
+        result.m_callPosition = context.m_callPosition;
+        result.m_functions = std::move(functions);
+        return true;
     }
 
-    return nullptr;
+    return false;
 }
 
-TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal(const TextEditor::AssistInterface *interface)
+LuaCompletionAssistProcessor::Context LuaCompletionAssistProcessor::detectContext(const TextEditor::AssistInterface *interface)
 {
-    if(interface->reason() == TextEditor::IdleEditor && !acceptsIdleEditor())
-        return 0;
-
+    Context context;
     int pos = interface->position() - 1;
     QChar ch = interface->characterAt(pos);
 
@@ -318,12 +440,13 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
         ch = interface->characterAt(--pos);
     }
 
-    bool isFunctionCall = (ch == QLatin1Char('(')) || (ch == QLatin1Char(','));
-    bool isMemberCompletion = (ch == QLatin1Char('.'));
-    bool isFunctionCompletion = (ch == QLatin1Char(':'));
-    bool isWordCompletion = !isFunctionCall && !isMemberCompletion && !isFunctionCompletion;
+    context.m_position = pos;
+    context.m_isFunctionCall = (ch == QLatin1Char('(')) || (ch == QLatin1Char(','));
+    context.m_isMemberCompletion = (ch == QLatin1Char('.'));
+    context.m_isFunctionCompletion = (ch == QLatin1Char(':'));
+    context.m_isWordCompletion = !context.m_isFunctionCall && !context.m_isMemberCompletion && !context.m_isFunctionCompletion;
 
-    QString currentMember;
+    QString &currentMember = context.m_currentMember;
 
     {
         int cpos = pos-1;
@@ -335,15 +458,13 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
             --cpos;
         ++cpos; ++cpos_end;
 
-        if (isWordCompletion)
+        if (context.m_isWordCompletion)
             ++cpos_end;
 
         currentMember = interface->textAt(cpos, cpos_end-cpos);
     }
 
-    bool isPerfectMatch = false;
-    QStringList perfectContextMatches;
-    if (isMemberCompletion || isFunctionCompletion)
+    if (context.m_isMemberCompletion || context.m_isFunctionCompletion)
     {
         if (currentMember.isEmpty())
         {
@@ -361,9 +482,41 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
         // we accept Foo(): as well
         if (currentMember.endsWith("()"))
             currentMember = currentMember.left(currentMember.size() - 2);
+    }
 
-        FunctionParser::FunctionList parsedFunctions = FunctionParser::parseFunctionsInFile(interface->fileName());
-        for (QSharedPointer<FunctionParser::Function> &parsedFunction : parsedFunctions)
+    if (context.m_isFunctionCall)
+    {
+        // the parameter list the cursor is in, if the innermost open bracket is a parenthesis
+        LuaBlockData::OpenBracket open = LuaBlockData::openBracketAt(interface->textDocument(), pos + 1);
+        if (open.m_bracket == QLatin1Char('('))
+            context.m_callPosition = open.m_position;
+    }
+
+    context.m_startPosition = pos+1;
+
+    if (context.m_isWordCompletion)
+    {
+        context.m_startPosition -= currentMember.length();
+    }
+
+    return context;
+}
+
+void LuaCompletionAssistProcessor::createContent(QFutureInterface<Result> &future, const Request &request, Result &result)
+{
+    const TextEditor::AssistInterface *interface = request.m_interface.data();
+    const DocumentationPack &pack = request.m_documentation->m_pack;
+    const Context &context = request.m_context;
+    bool isMemberCompletion = context.m_isMemberCompletion;
+    bool isFunctionCompletion = context.m_isFunctionCompletion;
+    bool isWordCompletion = context.m_isWordCompletion;
+    const QString &currentMember = context.m_currentMember;
+
+    bool isPerfectMatch = false;
+    QStringList perfectContextMatches;
+    if (isMemberCompletion || isFunctionCompletion)
+    {
+        for (const QSharedPointer<FunctionParser::Function> &parsedFunction : request.m_functions)
         {
             if (parsedFunction->surroundingName == currentMember)
             {
@@ -373,19 +526,15 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
 
         if (isFunctionCompletion)
         {
-            auto it = predefinedFunctionInfosByObject.find(currentMember);
-            if (it != predefinedFunctionInfosByObject.end())
+            for (const Function &parsedFunction : pack.functionsByObject(currentMember))
             {
-                for (const Function &parsedFunction : it.value())
-                {
-                    perfectContextMatches.push_back(parsedFunction.m_functionName);
-                }
+                perfectContextMatches.push_back(parsedFunction.m_functionName);
             }
         }
 
         if (isMemberCompletion)
         {
-            perfectContextMatches.append(predefinedMemberInfos[currentMember]);
+            perfectContextMatches.append(pack.memberInfos(currentMember));
         }
 
         isPerfectMatch = !perfectContextMatches.isEmpty();
@@ -399,20 +548,34 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
     QStringList functionsInDocument;
     RecursiveClassMembers targetIds;
 
+    if (future.isCanceled())
+        return;
+
     if (!isPerfectMatch)
     {
-        Scanner::TakeBackwardsState(interface->textDocument()->findBlockByLineNumber(interface->textDocument()->findBlock(interface->position()).firstLineNumber()-1),&targetIds);
+        // members are looked up in every identifier chain, names only in the visible scopes
+        if (isMemberCompletion || isFunctionCompletion)
+        {
+            for (const QStringList &chain : request.m_identifierChains)
+            {
+                RecursiveClassMembers *member = &targetIds;
+                for (const QString &identifier : chain)
+                    member = &(*member)[identifier];
+            }
+        }
 
         if (isFunctionCompletion || isWordCompletion)
         {
-            FunctionParser::FunctionList parsedFunctions = FunctionParser::parseFunctionsInFile(interface->fileName());
-            for (QSharedPointer<FunctionParser::Function> &parsedFunction : parsedFunctions)
+            for (const QSharedPointer<FunctionParser::Function> &parsedFunction : request.m_functions)
             {
                 functionsInDocument.append(parsedFunction->functionName);
             }
         }
     }
 
+    if (future.isCanceled())
+        return;
+
     if (isPerfectMatch)
     {
         // show only the ones that match perfectly
@@ -448,72 +611,64 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
 
         if (isFunctionCompletion)
         {
-            globVariables.append({predefinedCalls, 2});
+            globVariables.append({pack.calls(), 2});
             globVariables.append({functionsInDocument, 2});
         }
 
         if (isMemberCompletion)
-            globVariables.append({predefinedMembers, 2});
+            globVariables.append({pack.members(), 2});
 
         globVariables.append({g_special,1});
         magics.append({g_magics,0});
     }
     else if (isWordCompletion)
     {
-        QString lowerWord = currentMember.toLower();
-
-        for (auto it = targetIds.begin(); it != targetIds.end(); ++it)
+        // compared in place, without a lowercased copy of every candidate
+        for (const QString &name : request.m_visibleNames)
         {
-            if (it->key().toLower().startsWith(lowerWord))
-                variables.append({it->key(),5});
+            if (name.startsWith(currentMember, Qt::CaseInsensitive))
+                variables.append({name, 5});
         }
 
         for (const QString &str : functionsInDocument)
         {
-            if (str.toLower().startsWith(lowerWord))
+            if (str.startsWith(currentMember, Qt::CaseInsensitive))
                 variables.append({str, 4});
         }
 
-        for (const QString &str : predefinedWords)
-        {
-            if (str.toLower().startsWith(lowerWord))
-                variables.append({str, 4});
-        }
+        variables.append({pack.wordsStartingWith(currentMember), 4});
 
         for (const QString &str : g_special)
         {
-            if (str.toLower().startsWith(lowerWord))
+            if (str.startsWith(currentMember, Qt::CaseInsensitive))
                 variables.append({str, 3});
         }
         for (const QString &str : g_types)
         {
-            if (str.toLower().startsWith(lowerWord))
+            if (str.startsWith(currentMember, Qt::CaseInsensitive))
                 variables.append({str, 2});
         }
         for (const QString &str : g_keyword_beginning)
         {
-            if (str.toLower().startsWith(lowerWord))
+            if (str.startsWith(currentMember, Qt::CaseInsensitive))
                 variables.append({str, 1});
         }
         for (const QString &str : g_keyword_fcall)
         {
-            if (str.toLower().startsWith(lowerWord))
+            if (str.startsWith(currentMember, Qt::CaseInsensitive))
                 variables.append({str, 0});
         }
     }
     else
     {
-        for(auto it = targetIds.begin(); it != targetIds.end(); ++it)
-        {
-            variables.append({it->key(),4});
-        }
+        variables.append({request.m_visibleNames, 4});
         variables.append({g_special,3});
         keywords.append({g_types,2});
         keywords.append({g_keyword_beginning,1});
         keywords.append({g_keyword_fcall,0});
     }
 
-    QList<TextEditor::AssistProposalItemInterface*> m_completions;
+    QVector<Completion> &completions = result.m_completions;
 
     QSet<QString> m_usedSuggestions;
 
@@ -524,7 +679,7 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
         {
             if(!m_usedSuggestions.contains(*itb))
             {
-                m_completions << createCompletionItem(*itb, m_memIcon, plit.m_pr);
+                completions.push_back({*itb, LuaCompletionProposalModel::MemIcon, plit.m_pr});
                 m_usedSuggestions.insert(*itb);
             }
         }
@@ -536,7 +691,7 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
         {
             if(!m_usedSuggestions.contains(*itb))
             {
-                m_completions << createCompletionItem(*itb, m_varIcon, plit.m_pr);
+                completions.push_back({*itb, LuaCompletionProposalModel::VarIcon, plit.m_pr});
                 m_usedSuggestions.insert(*itb);
             }
         }
@@ -548,7 +703,7 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
         {
             if(!m_usedSuggestions.contains(*itb))
             {
-                m_completions << createCompletionItem(*itb, m_keywordIcon, plit.m_pr);
+                completions.push_back({*itb, LuaCompletionProposalModel::KeywordIcon, plit.m_pr});
                 m_usedSuggestions.insert(*itb);
             }
         }
@@ -560,20 +715,13 @@ TextEditor::GenericProposal *LuaCompletionAssistProcessor::createContentProposal
         {
             if(!m_usedSuggestions.contains(*itb))
             {
-                m_completions << createCompletionItem(*itb, m_functionIcon, plit.m_pr);
+                completions.push_back({*itb, LuaCompletionProposalModel::FunctionIcon, plit.m_pr});
                 m_usedSuggestions.insert(*itb);
             }
         }
     }
 
-    m_startPosition = pos+1;
-
-    if (isWordCompletion)
-    {
-        m_startPosition -= currentMember.length();
-    }
-
-    return new TextEditor::GenericProposal(m_startPosition, m_completions);
+    result.m_startPosition = context.m_startPosition;
 }
 
 
@@ -15,49 +15,119 @@
 #ifndef LUACOMPLETIONASSISTPROCESSOR_H
 #define LUACOMPLETIONASSISTPROCESSOR_H
 #include "luaeditor_global.h"
+#include "luacompletionproposalmodel.h"
 #include "luafunctionhintproposalmodel.h"
+#include "luafunctionparser.h"
+#include "predefineddocumentationparser.h"
 #include <texteditor/codeassist/iassistprocessor.h>
+#include <QFutureInterface>
+#include <QFutureWatcher>
 #include <QIcon>
+#include <QPointer>
+#include <QSharedPointer>
 #include <QString>
 #include <QMap>
 
+QT_FORWARD_DECLARE_CLASS(QTextDocument)
+
 namespace TextEditor {
+class AssistInterface;
 class GenericProposal;
 }
 
 namespace LuaEditor { namespace Internal {
 
+// Computes proposals on a worker thread from a snapshot of the document,
+// see perform(). Only the proposal of a request that wasn't cancelled is
+// delivered, and the worker doesn't touch the processor, so cancelling never
+// waits for it.
 class LuaCompletionAssistProcessor : public TextEditor::IAssistProcessor
 {
 public:
     typedef LuaFunctionHintProposalModel::Function Function;
+    typedef LuaCompletionProposalModel::Completion Completion;
+
+    // what a request found; proposals are created from it on the GUI thread
+    struct Result
+    {
+        int m_startPosition = 0;
+        bool m_isFunctionHint = false;
+        // the parenthesis opening the parameter list of a function hint
+        int m_callPosition = -1;
+        QVector<Function> m_functions;
+        QVector<Completion> m_completions;
+    };
+
+    // what is completed at the cursor, detected without any parsing
+    struct Context
+    {
+        int m_position = -1;
+        int m_startPosition = 0;
+        bool m_isFunctionCall = false;
+        bool m_isMemberCompletion = false;
+        bool m_isFunctionCompletion = false;
+        bool m_isWordCompletion = false;
+        // the innermost open parenthesis for a function call, -1 if there is none
+        int m_callPosition = -1;
+        // the word typed so far, or the object for member and function completion
+        QString m_currentMember;
+    };
+
+    // everything a request reads on the worker thread
+    struct Request
+    {
+        QSharedPointer<TextEditor::AssistInterface> m_interface;
+        PredefinedDocumentation::Ptr m_documentation;
+        Context m_context;
+        // functions of the document and the files it requires
+        FunctionParser::FunctionList m_functions;
+        // false if the functions of the required files still have to be parsed
+        bool m_hasDependencies = false;
+        // names declared in the scopes visible at the cursor, for word completion
+        QStringList m_visibleNames;
+        // identifier chains of the lines before the cursor, for member completion
+        QVector<QStringList> m_identifierChains;
+    };
+
+    // identifies the candidates of a content request, see perform()
+    struct CacheKey
+    {
+        const QTextDocument *m_document = nullptr;
+        QString m_fileName;
+        int m_generation = -1;
+        int m_documentationRevision = -1;
+        Context m_context;
+    };
 
 public:
 	LuaCompletionAssistProcessor();
 	virtual ~LuaCompletionAssistProcessor();
 	TextEditor::IAssistProposal* perform(TextEditor::AssistInterface const* interface);
+	bool running() override;
+	void cancel() override;
 	virtual bool acceptsIdleEditor() const;
 	
-	int m_startPosition;
-	
 	QIcon m_varIcon;
 	QIcon m_functionIcon;
 	QIcon m_memIcon;
 	QIcon m_keywordIcon;
 
-    QStringList predefinedMembers;
-    QStringList predefinedCalls;
-    QStringList predefinedWords;
-    QMap<QString, QVector<Function>> predefinedFunctionInfosByFunction;
-    QMap<QString, QVector<Function>> predefinedFunctionInfosByObject;
-    QMap<QString, QStringList> predefinedMemberInfos;
+    PredefinedDocumentation::Ptr m_documentation;
+
+    static Context detectContext(TextEditor::AssistInterface const* interface);
+    static void run(QFutureInterface<Result> &future, Request request);
+    static bool tryCreateFunctionHint(const Request &request, Result &result);
+    static void createContent(QFutureInterface<Result> &future, const Request &request, Result &result);
 
-    void readWords(QStringList &out, QString path);
-    void readCalls(QStringList &words, QMap<QString, QVector<Function>> &functionsByFunction, QMap<QString, QVector<Function>> &functionsByObject, QString path);
-    void readMembers(QStringList &words, QMap<QString, QStringList> &members, QString path);
+private:
+    void resultReady();
+    TextEditor::IAssistProposal *createProposal(const Result &result) const;
+    TextEditor::IAssistProposal *narrowCachedProposal(const CacheKey &key) const;
 
-    TextEditor::GenericProposal *createContentProposal(const TextEditor::AssistInterface *interface);
-    TextEditor::IAssistProposal *tryCreateFunctionHintProposal(const TextEditor::AssistInterface *interface);
+    QFutureWatcher<Result> m_watcher;
+    CacheKey m_cacheKey;
+    // the document of the request, function hints follow the cursor in it
+    QPointer<QTextDocument> m_document;
 };
 
 } }
@@ -37,6 +37,12 @@ bool LuaCompletionAssistProvider::supportsEditor(Utils::Id editorId) const
     return editorId == Constants::C_LUAEDITOR_ID;
 }
 
+// the processor starts its own worker, see LuaCompletionAssistProcessor::perform()
+TextEditor::IAssistProvider::RunType LuaCompletionAssistProvider::runType() const
+{
+	return Asynchronous;
+}
+
 TextEditor::IAssistProcessor* LuaCompletionAssistProvider::createProcessor() const
 {
 	return new LuaCompletionAssistProcessor;
@@ -25,6 +25,7 @@ class LuaCompletionAssistProvider : public TextEditor::CompletionAssistProvider
 	Q_OBJECT
 public:
     bool supportsEditor(Utils::Id editorId) const;
+	RunType runType() const override;
 	TextEditor::IAssistProcessor* createProcessor() const;
 	int activationCharSequenceLength() const;
 	bool isActivationCharSequence(QString const& sequence) const;
@@ -0,0 +1,183 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luacompletionproposalmodel.h"
+#include <texteditor/codeassist/assistproposalitem.h>
+#include <texteditor/completionsettings.h>
+#include <texteditor/texteditorsettings.h>
+#include <utils/fuzzymatcher.h>
+#include <QRegularExpression>
+#include <algorithm>
+
+namespace LuaEditor { namespace Internal {
+
+LuaCompletionProposalModel::LuaCompletionProposalModel(QVector<Completion> &&completions, QIcon const* icons)
+    : m_completions(std::move(completions))
+{
+    for(int i = 0; i < IconCount; ++i)
+        m_icons[i] = icons[i];
+    reset();
+}
+
+LuaCompletionProposalModel::~LuaCompletionProposalModel()
+{
+    qDeleteAll(m_items);
+}
+
+void LuaCompletionProposalModel::reset()
+{
+    m_rows.resize(m_completions.size());
+    for(int i = 0; i < m_rows.size(); ++i)
+        m_rows[i] = i;
+}
+
+int LuaCompletionProposalModel::size() const
+{
+    return m_rows.size();
+}
+
+QString LuaCompletionProposalModel::text(int index) const
+{
+    return m_completions.at(m_rows.at(index)).m_text;
+}
+
+QIcon LuaCompletionProposalModel::icon(int index) const
+{
+    return m_icons[m_completions.at(m_rows.at(index)).m_icon];
+}
+
+QString LuaCompletionProposalModel::detail(int index) const
+{
+    return proposalItem(index)->detail();
+}
+
+int LuaCompletionProposalModel::persistentId(int index) const
+{
+    return m_rows.at(index);
+}
+
+bool LuaCompletionProposalModel::containsDuplicates() const
+{
+    // the processor only adds every text once
+    return false;
+}
+
+// the case sensitivity of the completion settings, like GenericProposalModel
+static Utils::FuzzyMatcher::CaseSensitivity caseSensitivity()
+{
+    switch(TextEditor::TextEditorSettings::completionSettings().m_caseSensitivity)
+    {
+    case TextEditor::CaseSensitive:
+        return Utils::FuzzyMatcher::CaseSensitivity::CaseSensitive;
+    case TextEditor::FirstLetterCaseSensitive:
+        return Utils::FuzzyMatcher::CaseSensitivity::FirstLetterCaseSensitive;
+    default:
+        return Utils::FuzzyMatcher::CaseSensitivity::CaseInsensitive;
+    }
+}
+
+void LuaCompletionProposalModel::filter(QString const& prefix)
+{
+    if(prefix.isEmpty())
+        return;
+
+    const QRegularExpression regExp = Utils::FuzzyMatcher::createRegExp(prefix, caseSensitivity());
+
+    QVector<int> rows;
+    for(int i = 0; i < m_completions.size(); ++i)
+    {
+        if(regExp.match(m_completions.at(i).m_text).hasMatch())
+            rows.push_back(i);
+    }
+    m_rows = std::move(rows);
+}
+
+bool LuaCompletionProposalModel::isSortable(QString const& prefix) const
+{
+    Q_UNUSED(prefix)
+    return true;
+}
+
+void LuaCompletionProposalModel::sort(QString const& prefix)
+{
+    // texts starting with the prefix come first, case sensitive matches
+    // before the others, then the higher order and the text
+    QVector<int> ranks(m_completions.size());
+    for(int row : m_rows)
+    {
+        const QString &text = m_completions.at(row).m_text;
+        ranks[row] = text.startsWith(prefix) ? 0
+                   : text.startsWith(prefix, Qt::CaseInsensitive) ? 1
+                   : 2;
+    }
+
+    std::stable_sort(m_rows.begin(), m_rows.end(), [this, &ranks](int a, int b) {
+        if(ranks.at(a) != ranks.at(b))
+            return ranks.at(a) < ranks.at(b);
+        const Completion &first = m_completions.at(a);
+        const Completion &second = m_completions.at(b);
+        if(first.m_order != second.m_order)
+            return first.m_order > second.m_order;
+        int compare = first.m_text.compare(second.m_text, Qt::CaseInsensitive);
+        if(compare != 0)
+            return compare < 0;
+        return first.m_text < second.m_text;
+    });
+}
+
+QString LuaCompletionProposalModel::proposalPrefix() const
+{
+    // like the base class, the common prefix of a few rows
+    if(size() >= 20 || size() < 2)
+        return QString();
+
+    QString commonPrefix = text(0);
+    for(int i = 1; i < size() && !commonPrefix.isEmpty(); ++i)
+    {
+        const QString &next = text(i);
+        int length = 0;
+        while(length < commonPrefix.size() && length < next.size() && commonPrefix.at(length) == next.at(length))
+            ++length;
+        commonPrefix.truncate(length);
+    }
+    return commonPrefix;
+}
+
+TextEditor::AssistProposalItemInterface* LuaCompletionProposalModel::proposalItem(int index) const
+{
+    int row = m_rows.at(index);
+    TextEditor::AssistProposalItemInterface*& item = m_items[row];
+    if(!item)
+    {
+        const Completion &completion = m_completions.at(row);
+        TextEditor::AssistProposalItem* created = new TextEditor::AssistProposalItem;
+        created->setText(completion.m_text);
+        created->setIcon(m_icons[completion.m_icon]);
+        created->setOrder(completion.m_order);
+        item = created;
+    }
+    return item;
+}
+
+int LuaCompletionProposalModel::indexOf(std::function<bool (TextEditor::AssistProposalItemInterface*)> const& predicate) const
+{
+    for(int i = 0; i < size(); ++i)
+    {
+        if(predicate(proposalItem(i)))
+            return i;
+    }
+    return -1;
+}
+
+} }
@@ -0,0 +1,81 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUACOMPLETIONPROPOSALMODEL_H
+#define LUACOMPLETIONPROPOSALMODEL_H
+#include "luaeditor_global.h"
+#include <texteditor/codeassist/genericproposalmodel.h>
+#include <QHash>
+#include <QIcon>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+namespace LuaEditor { namespace Internal {
+
+// Completion candidates as a flat array of text, icon and order. Filtering
+// and sorting only move row indices around; a TextEditor::AssistProposalItem
+// is created when the popup asks for the item of a row, which it does for
+// the visible ones. The base class' item list stays empty, every accessor
+// reading it is overridden.
+class LuaCompletionProposalModel : public TextEditor::GenericProposalModel
+{
+public:
+	enum CompletionIcon
+	{
+		VarIcon,
+		FunctionIcon,
+		MemIcon,
+		KeywordIcon,
+		IconCount
+	};
+	
+	struct Completion
+	{
+		QString m_text;
+		CompletionIcon m_icon;
+		int m_order;
+	};
+	
+public:
+	// icons holds IconCount icons, indexed by CompletionIcon
+	LuaCompletionProposalModel(QVector<Completion> &&completions, QIcon const* icons);
+	~LuaCompletionProposalModel() override;
+	
+	void reset() override;
+	int size() const override;
+	QString text(int index) const override;
+	QIcon icon(int index) const override;
+	QString detail(int index) const override;
+	int persistentId(int index) const override;
+	bool containsDuplicates() const override;
+	void filter(QString const& prefix) override;
+	bool isSortable(QString const& prefix) const override;
+	void sort(QString const& prefix) override;
+	QString proposalPrefix() const override;
+	TextEditor::AssistProposalItemInterface* proposalItem(int index) const override;
+	int indexOf(std::function<bool (TextEditor::AssistProposalItemInterface*)> const& predicate) const override;
+	
+private:
+	QVector<Completion> m_completions;
+	// indices into m_completions of the rows shown
+	QVector<int> m_rows;
+	QIcon m_icons[IconCount];
+	
+	// items created so far, by index into m_completions
+	mutable QHash<int, TextEditor::AssistProposalItemInterface*> m_items;
+};
+
+} }
+#endif // LUACOMPLETIONPROPOSALMODEL_H
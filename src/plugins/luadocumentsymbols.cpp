@@ -0,0 +1,162 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luadocumentsymbols.h"
+#include "luamodulegraph.h"
+#include "scanner/luablockdata.h"
+#include <utils/runextensions.h>
+#include <QTextBlock>
+#include <QTextDocument>
+
+namespace LuaEditor { namespace Internal {
+
+static int nextGeneration()
+{
+    static int generation = 0;
+    return ++generation;
+}
+
+DocumentSymbols::DocumentSymbols(QTextDocument* document)
+    : QObject(document),
+      m_document(document),
+      m_generation(nextGeneration()),
+      m_typingEnd(-1),
+      m_contentRevision(0),
+      m_functionsRevision(-1),
+      m_dependenciesRevision(-1),
+      m_dependenciesLoaded(false)
+{
+    connect(document, &QTextDocument::contentsChange, this, &DocumentSymbols::contentsChange);
+    connect(&m_dependencyWatcher, &QFutureWatcherBase::finished, this, &DocumentSymbols::dependenciesLoaded);
+}
+
+DocumentSymbols* DocumentSymbols::forDocument(QTextDocument* document)
+{
+    DocumentSymbols* symbols = document->findChild<DocumentSymbols*>(QString(), Qt::FindDirectChildrenOnly);
+    if(!symbols)
+        symbols = new DocumentSymbols(document);
+    return symbols;
+}
+
+FunctionParser::FunctionList const& DocumentSymbols::functions()
+{
+    if(m_functionsRevision == m_contentRevision)
+        return m_functions;
+
+    // the blocks keep their tokens and the functions parsed from them, only
+    // blocks scanned again since the last call are parsed
+    m_functions.clear();
+    int state = 0;
+    for(QTextBlock block = m_document->firstBlock(); block.isValid(); block = block.next())
+    {
+        state = LuaBlockData::get(block, state)->m_endState;
+        LuaBlockData* data = LuaBlockData::attach(block);
+
+        if(!data->m_functionsParsed)
+        {
+            data->m_functions.clear();
+            TokenBuffer const& tokens = data->m_tokens;
+            for(int i = 0; i < tokens.size(); ++i)
+            {
+                if(tokens.keyword(i) == Keyword_Function)
+                {
+                    data->m_functions = FunctionParser::parseFunctions(block.text(), tokens, block.blockNumber());
+                    break;
+                }
+            }
+            data->m_functionsParsed = true;
+            data->m_functionsLine = block.blockNumber();
+        }
+        else if(data->m_functionsLine != block.blockNumber())
+        {
+            // lines were inserted or removed before the block; the functions
+            // may still be used by a completion, they are copied
+            int shift = block.blockNumber() - data->m_functionsLine;
+            for(QSharedPointer<FunctionParser::Function>& function : data->m_functions)
+            {
+                QSharedPointer<FunctionParser::Function> moved(new FunctionParser::Function(*function));
+                moved->line += shift;
+                function = moved;
+            }
+            data->m_functionsLine = block.blockNumber();
+        }
+
+        m_functions.append(data->m_functions);
+    }
+
+    m_functionsRevision = m_contentRevision;
+    return m_functions;
+}
+
+bool DocumentSymbols::dependencyFunctions(QString const& fileName, FunctionParser::FunctionList& functions)
+{
+    if(fileName != m_fileName)
+    {
+        m_fileName = fileName;
+        m_dependenciesLoaded = false;
+        m_dependencies.clear();
+        loadDependencies(fileName);
+    }
+    else if(m_dependenciesRevision != ModuleGraph::revision())
+    {
+        // a file changed on disk, the previous dependencies are used until
+        // the new ones are loaded
+        loadDependencies(fileName);
+    }
+
+    functions = m_dependencies;
+    return m_dependenciesLoaded;
+}
+
+void DocumentSymbols::contentsChange(int position, int charsRemoved, int charsAdded)
+{
+    ++m_contentRevision;
+
+    bool identifierOnly = charsRemoved == 0 && charsAdded > 0;
+    for(int i = 0; identifierOnly && i < charsAdded; ++i)
+    {
+        QChar ch = m_document->characterAt(position + i);
+        identifierOnly = ch.isLetterOrNumber() || ch == QLatin1Char('_');
+    }
+    
+    // the first character of a word gets a new generation, the ones typed
+    // after it only extend the completion prefix
+    if(!identifierOnly || position != m_typingEnd)
+        m_generation = nextGeneration();
+    m_typingEnd = identifierOnly ? position + charsAdded : -1;
+}
+
+void DocumentSymbols::loadDependencies(QString const& fileName)
+{
+    if(m_dependencyWatcher.isRunning() && m_loadingFileName == fileName)
+        return;
+
+    m_dependenciesRevision = ModuleGraph::revision();
+    m_loadingFileName = fileName;
+    m_dependencyWatcher.setFuture(Utils::runAsync(&FunctionParser::parseDependencyFunctions, fileName));
+}
+
+void DocumentSymbols::dependenciesLoaded()
+{
+    // a load for another file name may have replaced the one that finished
+    if(m_dependencyWatcher.future().resultCount() == 0 || m_loadingFileName != m_fileName)
+        return;
+
+    m_dependencies = m_dependencyWatcher.result();
+    m_dependenciesLoaded = true;
+    // completions built without them are outdated
+    m_generation = nextGeneration();
+}
+
+} }
@@ -0,0 +1,75 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUADOCUMENTSYMBOLS_H
+#define LUADOCUMENTSYMBOLS_H
+#include "luaeditor_global.h"
+#include "luafunctionparser.h"
+#include <QFutureWatcher>
+#include <QObject>
+
+QT_FORWARD_DECLARE_CLASS(QTextDocument)
+
+namespace LuaEditor { namespace Internal {
+
+// Completion state of one open document, a child of its QTextDocument.
+// The symbol generation changes with every edit except typing on at the end
+// of the identifier characters typed last, that is the word being completed.
+// Generations are unique across documents.
+// The functions of the document are taken from its current text, the ones
+// of the files it requires are taken from the ModuleGraph on a worker thread
+// and kept until a file of the graph changes on disk, so completion doesn't
+// touch the file system. Only used on the GUI thread.
+class DocumentSymbols : public QObject
+{
+	Q_OBJECT
+public:
+	static DocumentSymbols* forDocument(QTextDocument* document);
+	
+	inline int generation() const { return m_generation; }
+	
+	// functions declared in the document, only the blocks changed since the
+	// last call are parsed again
+	FunctionParser::FunctionList const& functions();
+	// functions of the files required by fileName and of the Lua library;
+	// false while they are being loaded, they are loaded in the background then
+	bool dependencyFunctions(QString const& fileName, FunctionParser::FunctionList& functions);
+	
+private:
+	explicit DocumentSymbols(QTextDocument* document);
+	
+	void contentsChange(int position, int charsRemoved, int charsAdded);
+	void loadDependencies(QString const& fileName);
+	void dependenciesLoaded();
+	
+	QTextDocument* m_document;
+	int m_generation;
+	// end of the identifier characters typed last, -1 if the last edit was another one
+	int m_typingEnd;
+	
+	int m_contentRevision;
+	int m_functionsRevision;
+	FunctionParser::FunctionList m_functions;
+	
+	QString m_fileName;
+	// the ModuleGraph revision the dependencies were loaded at
+	int m_dependenciesRevision;
+	bool m_dependenciesLoaded;
+	FunctionParser::FunctionList m_dependencies;
+	QString m_loadingFileName;
+	QFutureWatcher<FunctionParser::FunctionList> m_dependencyWatcher;
+};
+
+} }
+#endif // LUADOCUMENTSYMBOLS_H
@@ -14,18 +14,30 @@ SOURCES += luaeditorplugin.cpp \
     luaeditorfactory.cpp \
     luahighlighter.cpp \
     scanner/luascanner.cpp \
+    scanner/luacharclass.cpp \
+    scanner/luascankernels.cpp \
     luaeditor_global.cpp \
     luaindenter.cpp \
     luaautocompleter.cpp \
     luacompletionassistprovider.cpp \
     luacompletionassistprocessor.cpp \
+    luacompletionproposalmodel.cpp \
     luafunctionhintproposalmodel.cpp \
     scanner/recursiveclassmembers.cpp \
+    scanner/luablockdata.cpp \
+    scanner/luasourcefile.cpp \
+    scanner/luaprescan.cpp \
     luaengine/luaEngine.cpp \
     luafunctionfilter.cpp \
     luafunctionparser.cpp \
-    predefineddocumentationparser.cpp
+    luamodulegraph.cpp \
+    predefineddocumentationparser.cpp \
+    documentationpack.cpp \
+    luadocumentsymbols.cpp
 
+equals(TEST, 1) {
+    SOURCES += luaeditorbenchmarks.cpp
+}
 
 HEADERS += luaeditorplugin.h \
     luaeditor_global.h \
@@ -37,16 +49,26 @@ HEADERS += luaeditorplugin.h \
     scanner/luascanner.h \
     scanner/luaformattoken.h \
     scanner/sourcecodestream.h \
+    scanner/luacharclass.h \
+    scanner/luascankernels.h \
+    scanner/luatokenbuffer.h \
     luaindenter.h \
     luaautocompleter.h \
     luacompletionassistprovider.h \
     luacompletionassistprocessor.h \
+    luacompletionproposalmodel.h \
     luafunctionhintproposalmodel.h \
     scanner/recursiveclassmembers.h \
+    scanner/luablockdata.h \
+    scanner/luasourcefile.h \
+    scanner/luaprescan.h \
     luaengine/luaengine.h \
     luafunctionfilter.h \
     luafunctionparser.h \
+    luamodulegraph.h \
     predefineddocumentationparser.h \
+    documentationpack.h \
+    luadocumentsymbols.h \
     luaengine/lua.hpp
 
 # Qt Creator linking
@@ -77,7 +99,8 @@ QTC_LIB_DEPENDS += \
 
 QTC_PLUGIN_DEPENDS += \
     coreplugin \
-    texteditor
+    texteditor \
+    projectexplorer
 
 QTC_PLUGIN_RECOMMENDS +=
 
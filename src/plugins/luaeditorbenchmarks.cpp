@@ -0,0 +1,204 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luaeditorplugin.h"
+#include "scanner/luablockdata.h"
+#include "scanner/luaprescan.h"
+#include "scanner/luascankernels.h"
+#include "scanner/luascanner.h"
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThread>
+#include <QtTest>
+
+// Benchmarks of the scanner, run with "qtcreator -test LuaEditor". The
+// documents are generated, so that runs on different machines compare.
+
+namespace LuaEditor { namespace Internal {
+
+enum DocumentKind
+{
+    CodeDocument,
+    CommentDocument,
+    StringDocument
+};
+
+static const char *const g_codeLines[] = {
+    "local function update(entity, dt)",
+    "    local speed = entity.speed * dt",
+    "    if entity.target ~= nil then",
+    "        entity.x = entity.x + (entity.target.x - entity.x) * speed",
+    "        entity.y = entity.y + (entity.target.y - entity.y) * speed",
+    "    end",
+    "    -- keep the entity inside its sector",
+    "    entity.label = \"sector \" .. tostring(entity.sector)",
+    "    return entity",
+    "end",
+    ""
+};
+
+// lineCount lines of ordinary code, or of 400 column line comments and 40
+// line block comments, or of 400 column strings and 40 line long strings
+static QString generateDocument(DocumentKind kind, int lineCount)
+{
+    const QString body(400, QLatin1Char('x'));
+    const int codeLineCount = sizeof(g_codeLines) / sizeof(g_codeLines[0]);
+
+    QStringList lines;
+    while(lines.size() < lineCount)
+    {
+        switch(kind)
+        {
+        case CodeDocument:
+            lines.push_back(QLatin1String(g_codeLines[lines.size() % codeLineCount]));
+            break;
+        case CommentDocument:
+            lines.push_back(QLatin1String("--[["));
+            for(int i = 0; i < 40; ++i)
+                lines.push_back(body);
+            lines.push_back(QLatin1String("]]"));
+            for(int i = 0; i < 40; ++i)
+                lines.push_back(QLatin1String("-- ") + body);
+            break;
+        case StringDocument:
+            lines.push_back(QLatin1String("local blob = [==["));
+            for(int i = 0; i < 40; ++i)
+                lines.push_back(body);
+            lines.push_back(QLatin1String("]==]"));
+            for(int i = 0; i < 40; ++i)
+                lines.push_back(QLatin1String("local s = \"") + body + QLatin1String("\""));
+            break;
+        }
+    }
+    return lines.mid(0, lineCount).join(QLatin1Char('\n'));
+}
+
+static void addDocumentKinds()
+{
+    QTest::addColumn<int>("kind");
+    QTest::newRow("code") << int(CodeDocument);
+    QTest::newRow("comments") << int(CommentDocument);
+    QTest::newRow("strings") << int(StringDocument);
+}
+
+void LuaEditorPlugin::benchmarkScanKernels_data()
+{
+    QTest::addColumn<int>("distance");
+    QTest::addColumn<bool>("vectorized");
+
+    for(int distance : {16, 256, 4096})
+    {
+        QTest::newRow(qPrintable(QString::fromLatin1("scalar/%1").arg(distance))) << distance << false;
+        QTest::newRow(qPrintable(QString::fromLatin1("vectorized/%1").arg(distance))) << distance << true;
+    }
+}
+
+// the search of the scanner through comment and string bodies, over 1M code
+// units with a terminator every distance units
+void LuaEditorPlugin::benchmarkScanKernels()
+{
+    QFETCH(int, distance);
+    QFETCH(bool, vectorized);
+
+    QString text(1 << 20, QLatin1Char('x'));
+    for(int i = distance - 1; i < text.size(); i += distance)
+        text[i] = QLatin1Char(']');
+    ushort const* units = text.utf16();
+
+    int found = 0;
+    QBENCHMARK {
+        for(int from = 0; from < text.size(); ++from)
+        {
+            if(vectorized)
+                from = ScanKernels::findFirstOf(units, from, text.size(), ']', '\\', '\n');
+            else
+                from = ScanKernels::findFirstOfScalar(units, from, text.size(), ']', '\\', '\n');
+            ++found;
+        }
+    }
+    QVERIFY(found > 0);
+}
+
+void LuaEditorPlugin::benchmarkScanner_data()
+{
+    addDocumentKinds();
+}
+
+// tokenizing 20000 lines, each with the end state of the one before
+void LuaEditorPlugin::benchmarkScanner()
+{
+    QFETCH(int, kind);
+
+    QStringList lines = generateDocument(DocumentKind(kind), 20000).split(QLatin1Char('\n'));
+    TokenBuffer tokens;
+    QBENCHMARK {
+        int state = 0;
+        for(QString const& line : lines)
+        {
+            Scanner::tokenize(line, state, tokens);
+            state = tokens.lineEndState(0);
+        }
+    }
+}
+
+void LuaEditorPlugin::benchmarkBlockScan_data()
+{
+    QTest::addColumn<int>("blockCount");
+
+    for(int blockCount : {5000, 10000, 20000, 40000})
+        QTest::newRow(qPrintable(QString::number(blockCount))) << blockCount;
+}
+
+// what LuaHighlighter does for every block of a document it highlights in
+// one go, without setting the formats
+void LuaEditorPlugin::benchmarkBlockScan()
+{
+    QFETCH(int, blockCount);
+
+    QTextDocument document(generateDocument(CodeDocument, blockCount));
+    QCOMPARE(document.blockCount(), blockCount);
+    QBENCHMARK {
+        int state = 0;
+        for(QTextBlock block = document.firstBlock(); block.isValid(); block = block.next())
+        {
+            LuaBlockData* data = LuaBlockData::attach(block);
+            data->scan(block.text(), block.revision(), state);
+            state = data->m_endState;
+        }
+    }
+}
+
+void LuaEditorPlugin::benchmarkPreScan_data()
+{
+    QTest::addColumn<int>("threadCount");
+
+    // more threads than cores show the overhead of the chunks
+    for(int threadCount = 1; threadCount <= qMax(8, QThread::idealThreadCount()); threadCount *= 2)
+        QTest::newRow(qPrintable(QString::number(threadCount))) << threadCount;
+}
+
+// pre-scanning the snapshot of a document of 200000 lines
+void LuaEditorPlugin::benchmarkPreScan()
+{
+    QFETCH(int, threadCount);
+
+    QStringList lines = generateDocument(CodeDocument, 200000).split(QLatin1Char('\n'));
+    QSharedPointer<PreScan> preScan;
+    QBENCHMARK {
+        preScan = PreScan::createFromLines(lines, threadCount);
+    }
+    QCOMPARE(preScan->lineCount(), 200000);
+}
+
+} }
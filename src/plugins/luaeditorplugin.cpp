@@ -16,6 +16,8 @@
 #include "luaeditorfactory.h"
 #include "luaeditorconstants.h"
 #include "luafunctionfilter.h"
+#include "luamodulegraph.h"
+#include "predefineddocumentationparser.h"
 
 #include <coreplugin/actionmanager/actioncontainer.h>
 #include <coreplugin/actionmanager/actionmanager.h>
@@ -31,6 +33,8 @@ class LuaEditorPluginPrivate : public QObject {
     
     LuaEditorFactory luaEditorFactory;
     LuaFunctionFilter luaFunctionFilter;
+    PredefinedDocumentationWatcher predefinedDocumentationWatcher;
+    ModuleGraphWatcher moduleGraphWatcher;
 
     //LuaCompletionAssistProvider luaCompletionAssistProvider;
 };
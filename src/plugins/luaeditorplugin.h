@@ -36,6 +36,19 @@ public:
 	void extensionsInitialized() override;
 	ShutdownFlag aboutToShutdown() override;
 
+#ifdef WITH_TESTS
+private slots:
+	// see luaeditorbenchmarks.cpp
+	void benchmarkScanKernels_data();
+	void benchmarkScanKernels();
+	void benchmarkScanner_data();
+	void benchmarkScanner();
+	void benchmarkBlockScan_data();
+	void benchmarkBlockScan();
+	void benchmarkPreScan_data();
+	void benchmarkPreScan();
+#endif
+
 private:
 	class LuaEditorPluginPrivate *d = nullptr;
 };
@@ -13,8 +13,11 @@
 */
 
 #include "luaeditorwidget.h"
+#include "luahighlighter.h"
+#include <texteditor/textdocument.h>
 #include <QComboBox>
 #include <QHeaderView>
+#include <QScrollBar>
 #include <QTextBlock>
 #include <QTreeView>
 #include <utility>
@@ -34,6 +37,7 @@ LuaEditorWidget::LuaEditorWidget()
 	m_updateDocumentTimer.setSingleShot(true);
     connect(&m_updateDocumentTimer, &QTimer::timeout, this, &LuaEditorWidget::updateDocument);
     connect(this, &QPlainTextEdit::textChanged, [this](){m_updateDocumentTimer.start();});
+	connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &LuaEditorWidget::updateVisibleBlocks);
 	
 	m_outlineCombo->setMinimumContentsLength(22);
 	
@@ -51,6 +55,24 @@ LuaEditorWidget::LuaEditorWidget()
 	insertExtraToolBarWidget(TextEditorWidget::Left, m_outlineCombo);
 }
 
+void LuaEditorWidget::resizeEvent(QResizeEvent* e)
+{
+	TextEditorWidget::resizeEvent(e);
+	updateVisibleBlocks();
+}
+
+void LuaEditorWidget::updateVisibleBlocks()
+{
+	TextEditor::TextDocument* doc = textDocument();
+	LuaHighlighter* highlighter = doc ? dynamic_cast<LuaHighlighter*>(doc->syntaxHighlighter()) : nullptr;
+	if(!highlighter)
+		return;
+	
+	int first = firstVisibleBlock().blockNumber();
+	int visibleLines = viewport()->height() / qMax(fontMetrics().lineSpacing(), 1);
+	highlighter->setVisibleBlocks(first, first + visibleLines);
+}
+
 QTextEdit::ExtraSelection LuaEditorWidget::CreateExtraSelection(int lineNumber, const QTextCharFormat &errorFormat, const LuaEngine::Location *errorLocation, bool isFirstLine, bool isLastLine)
 {
 	QTextCursor cursor(document()->findBlockByLineNumber(lineNumber));
@@ -29,10 +29,16 @@ class LuaEditorWidget : public TextEditor::TextEditorWidget
 	QTextEdit::ExtraSelection CreateExtraSelection(int lineNumber, QTextCharFormat const& errorFormat,
 												   LuaEngine::Location const* errorLocation, bool isFirstLine, bool isLastLine);
 	
+	// tells the highlighter which blocks to highlight first
+	void updateVisibleBlocks();
+	
 	QTimer m_updateDocumentTimer;
 	QComboBox* m_outlineCombo;
 public:
 	LuaEditorWidget();
+	
+protected:
+	void resizeEvent(QResizeEvent* e) override;
 };
 
 } }
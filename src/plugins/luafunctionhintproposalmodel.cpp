@@ -13,6 +13,7 @@
 */
 
 #include "luafunctionhintproposalmodel.h"
+#include "scanner/luablockdata.h"
 #include "scanner/luascanner.h"
 
 #include <iostream>
@@ -41,6 +42,15 @@ LuaFunctionHintProposalModel::LuaFunctionHintProposalModel(QVector<LuaFunctionHi
 
 }
 
+LuaFunctionHintProposalModel::LuaFunctionHintProposalModel(QVector<LuaFunctionHintProposalModel::Function> &&functions, QTextDocument *document, int basePosition, int callPosition) :
+    m_functions(std::move(functions)),
+    m_document(document),
+    m_basePosition(basePosition),
+    m_callPosition(callPosition)
+{
+
+}
+
 void LuaFunctionHintProposalModel::reset()
 {
 
@@ -84,42 +94,106 @@ QString LuaFunctionHintProposalModel::text(int index) const
     return hintText;
 }
 
-int LuaFunctionHintProposalModel::activeArgument(const QString &prefix) const
+// counts the arguments in the operator tokens of text in [begin, end)
+static void countArguments(const QString &text, const TokenBuffer &tokens, int begin, int end,
+                           LuaFunctionHintProposalModel::ArgumentState &state)
 {
-    int parentheses = -1; // start at -1, we'll enter the parameter list during the loop
-    int brackets = 0;
-    int curly = 0;
-    bool string = false;
-
-    int argument = 0;
-
-    for (const QChar &c : prefix)
+    for (int i = 0; i < tokens.size() && tokens.begin(i) < end && !state.m_closed; ++i)
     {
-        if (c == '\"') string = !string;
-
-        if (string) continue;
-
-        if (c == QChar('(')) parentheses++;
-        else if (c == QChar(')')) parentheses--;
-        else if (c == QChar('[')) brackets++;
-        else if (c == QChar(']')) brackets--;
-        else if (c == QChar('{')) curly++;
-        else if (c == QChar('}')) curly--;
-        else if (c == QChar(',')
-                 && curly == 0
-                 && brackets == 0
-                 && parentheses == 0)
+        if (tokens.format(i) != Format_Operator || tokens.end(i) <= begin)
+            continue;
+
+        int tokenEnd = qMin(qMin(tokens.end(i), end), text.size());
+        for (int offset = qMax(tokens.begin(i), begin); offset < tokenEnd; ++offset)
         {
-            argument++;
+            QChar c = text.at(offset);
+            if (c == QChar('(') || c == QChar('[') || c == QChar('{'))
+            {
+                state.m_depth++;
+            }
+            else if (c == QChar(')') || c == QChar(']') || c == QChar('}'))
+            {
+                // closing the parameter list ends the hint
+                if (state.m_depth <= 0)
+                {
+                    state.m_closed = true;
+                    return;
+                }
+                state.m_depth--;
+            }
+            else if (c == QChar(',') && state.m_depth == 0)
+            {
+                state.m_argument++;
+            }
         }
     }
+}
+
+int LuaFunctionHintProposalModel::activeArgument(const QString &prefix) const
+{
+    ArgumentState state;
+
+    if (m_document && m_callPosition >= 0)
+    {
+        state = argumentsInDocument(m_basePosition + prefix.size());
+    }
+    else
+    {
+        // the prefix starts at the function name, the parameter list is entered on the way
+        TokenBuffer tokens;
+        Scanner::tokenize(prefix, 0, tokens);
+        state.m_depth = -1;
+        countArguments(prefix, tokens, 0, prefix.size(), state);
+    }
 
-    if (!(curly == 0 && brackets == 0 && parentheses == 0))
-        argument = -1;
+    // outside of the parameter list, or inside a bracket nested in it
+    int argument = state.m_closed || state.m_depth != 0 ? -1 : state.m_argument;
 
     m_currentArgument = argument;
 
     return argument;
 }
 
+LuaFunctionHintProposalModel::ArgumentState LuaFunctionHintProposalModel::argumentsInDocument(int position) const
+{
+    QTextBlock block = m_document->findBlock(m_callPosition);
+    if (block.blockNumber() != m_callBlockNumber)
+    {
+        m_blockArguments.clear();
+        m_callBlockNumber = block.blockNumber();
+    }
+
+    // the whole blocks before the cursor are taken from the cache while they
+    // are unchanged, so typing only counts the line of the cursor again
+    ArgumentState state;
+    int begin = m_callPosition + 1 - block.position();
+    for (int index = 0; block.isValid() && block.position() + block.length() <= position; ++index)
+    {
+        const LuaBlockData *data = LuaBlockData::get(block);
+        if (index < m_blockArguments.size()
+                && m_blockArguments.at(index).m_revision == block.revision()
+                && m_blockArguments.at(index).m_initialState == data->m_initialState)
+        {
+            state = m_blockArguments.at(index).m_state;
+        }
+        else
+        {
+            countArguments(block.text(), data->m_tokens, begin, block.length(), state);
+            m_blockArguments.resize(index);
+            m_blockArguments.push_back({block.revision(), data->m_initialState, state});
+        }
+
+        if (state.m_closed)
+            return state;
+
+        begin = 0;
+        block = block.next();
+    }
+
+    if (block.isValid())
+        countArguments(block.text(), LuaBlockData::get(block)->m_tokens, begin, position - block.position(), state);
+
+    return state;
+}
+
 } }
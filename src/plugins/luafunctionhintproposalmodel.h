@@ -17,6 +17,9 @@
 #include "luaeditor_global.h"
 #include <texteditor/codeassist/ifunctionhintproposalmodel.h>
 #include "luaengine/luaengine.h"
+#include <QPointer>
+#include <QTextBlock>
+#include <QTextDocument>
 #include <QVector>
 
 namespace LuaEditor { namespace Internal {
@@ -34,8 +37,21 @@ public:
         QVector<QString> m_arguments;
     };
 
+    // the arguments counted up to a position of the parameter list
+    struct ArgumentState
+    {
+        int m_argument = 0;
+        // of the brackets nested in the parameter list
+        int m_depth = 0;
+        // whether the parameter list was closed
+        bool m_closed = false;
+    };
+
 public:
     LuaFunctionHintProposalModel(QVector<Function> &&functions);
+    // callPosition is the parenthesis opening the parameter list in document,
+    // basePosition the position the prefix passed to activeArgument() starts at
+    LuaFunctionHintProposalModel(QVector<Function> &&functions, QTextDocument *document, int basePosition, int callPosition);
 
 	void reset();
 	int size() const;
@@ -43,8 +59,26 @@ public:
 	int activeArgument(QString const& prefix) const;
 
 private:
+    // the state at the end of a block of the parameter list
+    struct BlockArguments
+    {
+        int m_revision;
+        int m_initialState;
+        ArgumentState m_state;
+    };
+
+    ArgumentState argumentsInDocument(int position) const;
+
     QVector<Function> m_functions;
 
+    QPointer<QTextDocument> m_document;
+    int m_basePosition = 0;
+    int m_callPosition = -1;
+
+    // per block from the one of the call position on, while the hint is shown
+    mutable QVector<BlockArguments> m_blockArguments;
+    mutable int m_callBlockNumber = -1;
+
     mutable int m_currentArgument = 0;
 };
 
@@ -1,14 +1,13 @@
 #include "luafunctionparser.h"
+#include "luaeditor_global.h"
+#include "luamodulegraph.h"
+#include "scanner/luascanner.h"
+#include "scanner/luasourcefile.h"
 
-#include <QFile>
 #include <QFileInfo>
-#include <QDateTime>
-#include <QMap>
 #include <QSet>
 #include <QDir>
 
-#include <iostream>
-
 namespace LuaEditor { namespace Internal {
 
 FunctionParser::Function::Function(QString functionName,
@@ -44,314 +43,346 @@ FunctionParser::Function::Function(QString functionName,
     fullFunction += this->arguments;
 }
 
-QString FunctionParser::requireExists(QDir directory, QStringList packagePaths, QString require)
+QString FunctionParser::requireExists(QDir directory, QStringList packagePaths, QString require,
+                                      QStringList *listedDirectories)
 {
-    QFileInfo test = directory.absoluteFilePath(require);
-    if (test.exists() && test.isFile())
-        return test.canonicalFilePath();
-
-    test = directory.absoluteFilePath(require + ".lua");
-    if (test.exists() && test.isFile())
-        return test.canonicalFilePath();
-
+    QStringList candidates = {require, require + ".lua"};
     for (QString packagePath : packagePaths)
     {
         QString str = packagePath.replace("?", require);
+        candidates << str << str + ".lua";
+    }
 
-        QFileInfo test = directory.absoluteFilePath(str);
-        if (test.exists() && test.isFile())
-            return test.canonicalFilePath();
-
-        test = directory.absoluteFilePath(str + ".lua");
-        if (test.exists() && test.isFile())
-            return test.canonicalFilePath();
+    // the directories are listed once, only the file found is looked up
+    for (const QString &candidate : candidates)
+    {
+        QString path = directory.absoluteFilePath(candidate);
+        QString listed;
+        bool found = ModuleGraph::isFile(path, &listed);
+        if (listedDirectories)
+            listedDirectories->push_back(listed);
+        if (found)
+            return QFileInfo(path).canonicalFilePath();
     }
 
     return QString();
 }
 
-QStringList FunctionParser::parseRequiredFiles(QFile &ifile)
+// contents of a string literal token, without the quotes or long brackets
+static QString stringContents(const QString &literal)
 {
-    static QMap<QString, std::pair<QDateTime, QStringList>> cache;
-
-    auto it = cache.find(ifile.fileName());
-    if (it != cache.end())
+    int open = 1;
+    if (literal.startsWith(QChar('[')))
     {
-        QFileInfo info(ifile.fileName());
-        const QDateTime &read = it->first;
-
-        // if the read happened later than the last modification, it's up to date
-        if (info.lastModified() < read)
-        {
-            return it->second;
-        }
+        // [[...]], [=[...]=], ...
+        while (open < literal.size() && literal.at(open) == QChar('='))
+            ++open;
+        ++open;
     }
 
-    // read whole content
-    ifile.open(QIODevice::ReadOnly | QIODevice::Text);
-    QString content = QString::fromLatin1(ifile.readAll());
-    ifile.close();
-
-    QStringList parts = content.split(QChar('\n'));
+    // unterminated strings only have the opening delimiter
+    int close = literal.size() >= 2 * open && literal.endsWith(literal.at(0) == QChar('[') ? QChar(']') : literal.at(0)) ? open : 0;
+    return literal.mid(open, literal.size() - open - close);
+}
 
-    QStringList result;
+QVector<FunctionParser::Import> FunctionParser::parseImports(const SourceFile &source)
+{
+    QVector<Import> imports;
+    const TokenBuffer &tokens = source.tokens();
 
-    QString functionExpression(R"(.*function\s*((.*)\s*(\(.*\))).*)");
+    QVector<int> significant;
+    significant.reserve(tokens.size());
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        Format format = tokens.format(i);
+        if (format != Format_Whitespace && format != Format_Comment && format != Format_MLComment)
+            significant.push_back(i);
+    }
 
-    // search package paths
-    QStringList packagePaths;
-    QString packagePathExpression(R"EXPR(.*package\s*.\s*path\s*.*"(.*)".*)EXPR");
+    auto is = [&](int n, Format format, const char *text) {
+        return n < significant.size() && tokens.format(significant.at(n)) == format
+            && source.tokenEquals(significant.at(n), QLatin1String(text));
+    };
+    auto isString = [&](int n) {
+        return n < significant.size() && tokens.format(significant.at(n)) == Format_String;
+    };
+    auto import = [&](Import::Kind kind, int n) {
+        int token = significant.at(n);
+        imports.push_back({kind, stringContents(source.text(token)), source.lineNumber(tokens.begin(token))});
+    };
 
-    for (int i = 0; i < parts.size(); ++i)
+    for (int n = 0; n < significant.size(); ++n)
     {
-        QRegExp regex(packagePathExpression);
-        regex.setMinimal(true);
+        if (tokens.format(significant.at(n)) != Format_Identifier)
+            continue;
 
-        if (regex.indexIn(parts[i]) != -1)
+        bool isRequire = is(n, Format_Identifier, "require");
+        if (isRequire || is(n, Format_Identifier, "include"))
         {
-            QStringList capturedTexts = regex.capturedTexts();
-            QString packagePath = capturedTexts[1];
-
-            QStringList pathParts = packagePath.split(';');
-            for (const QString &part : pathParts)
+            // require "x", require [[x]], require("x")
+            int m = n+1;
+            if (m < significant.size() && tokens.format(significant.at(m)) == Format_Operator
+                    && source.data()[tokens.begin(significant.at(m))] == '(')
+                ++m;
+            if (isString(m))
+                import(isRequire ? Import::Require : Import::Include, m);
+        }
+        else if (is(n, Format_Identifier, "package") && is(n+1, Format_Operator, ".")
+                 && is(n+2, Format_Identifier, "path") && is(n+3, Format_Operator, "="))
+        {
+            // package.path = package.path .. ";a/?.lua" .. ";b/?.lua"
+            for (int m = n+4; m < significant.size(); ++m)
             {
-                QString trimmed = part.trimmed();
-
-                if (!trimmed.isEmpty())
-                    packagePaths.push_back(trimmed);
+                if (isString(m))
+                    import(Import::PackagePath, m);
+                else if (!is(m, Format_Operator, "..") && !is(m, Format_Operator, ".")
+                         && !is(m, Format_Identifier, "package") && !is(m, Format_Identifier, "path"))
+                    break;
             }
         }
     }
 
-    // search require("") expressions
-    QStringList requires;
-    QString requireExpression(R"EXPR(.*require\s*.*"(.*)".*)EXPR");
+    return imports;
+}
 
-    for (int i = 0; i < parts.size(); ++i)
-    {
-        QRegExp regex(requireExpression);
-        regex.setMinimal(true);
+QStringList FunctionParser::resolveImports(const QString &fileName, const QVector<Import> &imports)
+{
+    QStringList result;
 
-        if (regex.indexIn(parts[i]) != -1)
+    QStringList packagePaths;
+    QVector<Import> requires;
+    QSet<QString> names;
+    for (const Import &import : imports)
+    {
+        if (import.kind == Import::PackagePath)
         {
-            QStringList capturedTexts = regex.capturedTexts();
-            QString require = capturedTexts[1];
+            for (const QString &part : import.name.split(';'))
+            {
+                QString trimmed = part.trimmed();
 
-            requires.push_back(require);
+                if (!trimmed.isEmpty())
+                    packagePaths.push_back(trimmed);
+            }
         }
-    }
-
-    QString includeExpression(R"EXPR(.*include\s*.*"(.*)".*)EXPR");
-
-    for (int i = 0; i < parts.size(); ++i)
-    {
-        QRegExp regex(includeExpression);
-        regex.setMinimal(true);
-
-        if (regex.indexIn(parts[i]) != -1)
+        else if (!names.contains(import.name))
         {
-            QStringList capturedTexts = regex.capturedTexts();
-            QString require = capturedTexts[1];
-
-            requires.push_back(require);
+            names.insert(import.name);
+            requires.push_back(import);
         }
     }
 
     // resolve all require expressions with the help of package paths
-    QFileInfo path = ifile.fileName();
+    QFileInfo path = fileName;
     QDir directory = path.dir();
+    QString root = ModuleGraph::searchRoot(fileName);
 
-    // walk up
-    do
+    // walk up to the search root, the directories above it aren't listed
+    while (!requires.isEmpty())
     {
-        QStringList found;
-        for (QString require : requires)
+        for (int i = 0; i < requires.size(); )
         {
-            QString path = requireExists(directory, packagePaths, require);
+            QString path = ModuleGraph::resolve(directory, packagePaths, requires.at(i).name);
             if (!path.isEmpty())
             {
                 result.push_back(path);
-                found.push_back(require);
+                requires.remove(i);
             }
+            else
+                ++i;
         }
 
-        for (QString &foundRequire : found)
-            requires.removeAll(foundRequire);
-
-        if (requires.empty())
+        if (directory.absolutePath() == root || !directory.cdUp())
             break;
     }
-    while(directory.cdUp());
 
-    for (QString str : requires)
+    for (const Import &require : requires)
     {
-        std::cout << "not found: " << str.toStdString() << std::endl;
+        LOG("not found: " << require.name.toStdString()
+            << " (" << fileName.toStdString() << ":" << require.line << ")");
     }
 
-    // update cache
-    cache[ifile.fileName()] = std::make_pair(QDateTime::currentDateTime(), result);
-
     return result;
 }
 
-
-QStringList FunctionParser::findDependencies(const QString &path)
+QList<QSharedPointer<FunctionParser::Function>> FunctionParser::parseDependencyFunctions(const QString &path)
 {
-    QSet<QString> scanned;
-
-    QStringList dependencies;
-    QStringList todo = {path};
-
-    while(!todo.isEmpty())
-    {
-        QString current = todo.front();
-        todo.pop_front();
-
-        if (scanned.contains(current)) continue;
-        scanned.insert(current);
-
-        QFile ifile(current);
-        if (!ifile.exists())
-            continue;
-
-        dependencies.push_back(current);
-
-        todo.append(parseRequiredFiles(ifile));
-    }
-
-    return dependencies;
+    return ModuleGraph::dependencyFunctions(path);
 }
 
-QList<QSharedPointer<FunctionParser::Function>> FunctionParser::parseFunctionsInFileNoRecursion(const QString &path)
+// text of a tokenized QString
+struct Utf16Text
 {
-    FunctionList result;
-
-    QFile ifile(path);
-    if (!ifile.exists())
-        return result;
+    const QString &text;
 
-    static QMap<QString, std::pair<QDateTime, FunctionList>> dates;
+    char charAt(int offset) const { return offset < text.size() ? text.at(offset).toLatin1() : '\0'; }
+    QString mid(int begin, int length) const { return text.mid(begin, length); }
+};
 
-    auto it = dates.find(path);
-    if (it != dates.end())
-    {
-        QFileInfo info(path);
-        const QDateTime &read = it->first;
-
-        // if the read happened later than the last modification, it's up to date
-        if (info.lastModified() < read)
-        {
-            return it->second;
-        }
-    }
-
-    ifile.open(QIODevice::ReadOnly | QIODevice::Text);
-    // read whole content
-    QString content = QString::fromLatin1(ifile.readAll());
-    ifile.close();
-
-    // get words
-    result = parseFunctions(content);
-
-    // update cache
-    dates[path] = std::make_pair(QDateTime::currentDateTime(), result);
-
-    return result;
-}
-
-
-QList<QSharedPointer<FunctionParser::Function>> FunctionParser::parseFunctionsInFile(const QString &path)
+// text of a tokenized SourceFile, in UTF-8
+struct Utf8Text
 {
-    FunctionList result;
-
-    QFile ifile(path);
-    if (!ifile.exists())
-        return result;
-
-    static QMap<QString, std::pair<QDateTime, FunctionList>> dates;
+    const SourceFile &source;
+
+    char charAt(int offset) const { return offset < source.size() ? source.data()[offset] : '\0'; }
+    QString mid(int begin, int length) const { return QString::fromUtf8(source.data() + begin, qMin(length, source.size() - begin)); }
+};
+
+// Finds function definitions in one pass over the tokens, strings and
+// comments are skipped with the whitespace:
+//   function a.b:c(x, y)       local function f(x)
+//   a.b = function(x)          local f = function(x)
+// Anonymous functions that aren't assigned to a name are left out.
+template<typename Text>
+static void extractFunctions(const TokenBuffer &tokens, const Text &text, int firstLine, FunctionParser::FunctionList &functions)
+{
+    typedef FunctionParser::Function Function;
 
-    auto it = dates.find(path);
-    if (it != dates.end())
+    QVector<int> significant;
+    significant.reserve(tokens.size());
+    for (int i = 0; i < tokens.size(); ++i)
     {
-        QFileInfo info(path);
-        const QDateTime &read = it->first;
+        Format format = tokens.format(i);
+        if (format != Format_Whitespace && format != Format_Comment && format != Format_MLComment)
+            significant.push_back(i);
+    }
 
-        // if the read happened later than the last modification, it's up to date
-        if (info.lastModified() < read)
+    // metamethod names like __index and self have their own formats
+    auto isNamePart = [&](int n) {
+        if (n < 0 || n >= significant.size())
+            return false;
+        Format format = tokens.format(significant.at(n));
+        return format == Format_Identifier || format == Format_MagicAttr || format == Format_ClassField;
+    };
+    // whether the token is the operator op, or starts with it if prefix is set
+    auto isOperator = [&](int n, const char *op, bool prefix) {
+        if (n < 0 || n >= significant.size() || tokens.format(significant.at(n)) != Format_Operator)
+            return false;
+        int begin = tokens.begin(significant.at(n));
+        int length = static_cast<int>(qstrlen(op));
+        if (tokens.length(significant.at(n)) < length || (!prefix && tokens.length(significant.at(n)) != length))
+            return false;
+        for (int i = 0; i < length; ++i)
         {
-            return it->second;
+            if (text.charAt(begin + i) != op[i])
+                return false;
         }
-    }
+        return true;
+    };
+    auto tokenText = [&](int n) {
+        return text.mid(tokens.begin(significant.at(n)), tokens.length(significant.at(n)));
+    };
 
-    for (QString file : findDependencies(path))
+    for (int n = 0; n < significant.size(); ++n)
     {
-        // get words
-        result.append(parseFunctionsInFileNoRecursion(file));
-    }
-    addLuaLibraryCalls(result);
-
-    // update cache
-    dates[path] = std::make_pair(QDateTime::currentDateTime(), result);
-
-    return result;
-}
-
-QList<QSharedPointer<FunctionParser::Function> > FunctionParser::parseFunctions(const QString &text)
-{
-    FunctionList functions;
-
-    QString searchExpression(R"(.*function\s*((.*)\s*(\(.*\))).*)");
+        int token = significant.at(n);
+        if (tokens.format(token) != Format_Keyword || tokens.keyword(token) != Keyword_Function)
+            continue;
 
-    QStringList parts = text.split(QChar('\n'));
-    for (int i = 0; i < parts.size(); ++i)
-    {
-        QRegExp regex(searchExpression);
-        regex.setMinimal(true);
+        // the name parts and their separators, from the first to the last part
+        QStringList parts;
+        bool isMethod = false;
+        bool isAssignment = false;
+        int nameBegin = -1;
+        int nameEnd = -1;
+        int parameters = -1;
 
-        if (regex.indexIn(parts[i]) != -1)
+        if (isNamePart(n+1))
         {
-            QSharedPointer<Function> entry(new Function());
-
-            QStringList capturedTexts = regex.capturedTexts();
-            QString functionName = capturedTexts[2];
-
-            if (functionName.trimmed().isEmpty())
-                continue;
-
-            QChar splitChar('\0');
-            if (functionName.contains(QChar(':')))
+            // function a.b:c(
+            int m = n+1;
+            nameBegin = tokens.begin(significant.at(m));
+            parts.push_back(tokenText(m));
+            while ((isOperator(m+1, ".", false) || isOperator(m+1, ":", false)) && isNamePart(m+2))
             {
-                entry->surroundingType = Function::SurroundingType::Object;
-                splitChar = QChar(':');
+                isMethod = isMethod || isOperator(m+1, ":", false);
+                parts.push_back(tokenText(m+2));
+                m += 2;
             }
-            else if (functionName.contains(QChar('.')))
+            nameEnd = tokens.end(significant.at(m));
+            if (isOperator(m+1, "(", true))
+                parameters = m+1;
+        }
+        else if (isOperator(n+1, "(", true) && isOperator(n-1, "=", false) && isNamePart(n-2))
+        {
+            // a.b = function(
+            int m = n-2;
+            isAssignment = true;
+            nameEnd = tokens.end(significant.at(m));
+            parts.push_front(tokenText(m));
+            while (isOperator(m-1, ".", false) && isNamePart(m-2))
             {
-                entry->surroundingType = Function::SurroundingType::Module;
-                splitChar = QChar('.');
+                parts.push_front(tokenText(m-2));
+                m -= 2;
             }
+            nameBegin = tokens.begin(significant.at(m));
+            parameters = n+1;
+        }
+
+        if (parameters < 0)
+            continue;
 
-            if (splitChar != QChar('\0'))
+        // the parameter list runs to the first closing parenthesis
+        int open = tokens.begin(significant.at(parameters));
+        int close = -1;
+        for (int m = parameters; m < significant.size() && close < 0; ++m)
+        {
+            int t = significant.at(m);
+            if (tokens.format(t) != Format_Operator)
+                continue;
+            for (int offset = qMax(tokens.begin(t), open + 1); offset < tokens.end(t); ++offset)
             {
-                auto parts = functionName.split(splitChar);
-                functionName = parts.last();
-                for (int j = 0; j < parts.size() - 1; ++j)
+                if (text.charAt(offset) == ')')
                 {
-                    if (j > 0)
-                        entry->surroundingName += QString(".");
-
-                    entry->surroundingName += parts[j].trimmed();
+                    close = offset;
+                    break;
                 }
             }
-
-            entry->line = i + 1;
-            entry->fullFunction = capturedTexts[1].trimmed();
-            entry->functionName = functionName.trimmed();
-            entry->arguments = capturedTexts[3].trimmed();
-
-            functions.push_back(entry);
         }
+
+        QString arguments = close >= 0 ? text.mid(open, close + 1 - open) : text.mid(open, tokens.end(significant.back()) - open) + QString(")");
+        if (arguments.contains(QChar('\n')))
+            arguments = arguments.simplified();
+
+        QSharedPointer<Function> entry(new Function());
+        entry->functionName = parts.takeLast();
+        entry->surroundingName = parts.join(QChar('.'));
+        if (isMethod)
+            entry->surroundingType = Function::SurroundingType::Object;
+        else if (!parts.isEmpty())
+            entry->surroundingType = Function::SurroundingType::Module;
+
+        if (!isAssignment && close >= 0)
+            entry->fullFunction = text.mid(nameBegin, close + 1 - nameBegin);
+        else
+            entry->fullFunction = text.mid(nameBegin, nameEnd - nameBegin) + arguments;
+        if (entry->fullFunction.contains(QChar('\n')))
+            entry->fullFunction = entry->fullFunction.simplified();
+
+        entry->line = firstLine + tokens.lineAt(tokens.begin(token)) + 1;
+        entry->arguments = arguments;
+
+        functions.push_back(entry);
     }
+}
+
+QList<QSharedPointer<FunctionParser::Function> > FunctionParser::parseFunctions(const QString &text)
+{
+    TokenBuffer tokens;
+    Scanner::tokenize(text, 0, tokens);
+    return parseFunctions(text, tokens, 0);
+}
 
+QList<QSharedPointer<FunctionParser::Function> > FunctionParser::parseFunctions(const QString &text, const TokenBuffer &tokens, int firstLine)
+{
+    FunctionList functions;
+    extractFunctions(tokens, Utf16Text{text}, firstLine, functions);
+    return functions;
+}
+
+QList<QSharedPointer<FunctionParser::Function> > FunctionParser::parseFunctions(const SourceFile &source)
+{
+    FunctionList functions;
+    extractFunctions(source.tokens(), Utf8Text{source}, 0, functions);
     return functions;
 }
 
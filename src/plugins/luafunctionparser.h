@@ -4,11 +4,14 @@
 #include <QString>
 #include <QSharedPointer>
 #include <QList>
-#include <QFile>
+#include <QVector>
 #include <QDir>
 
 namespace LuaEditor { namespace Internal {
 
+class SourceFile;
+class TokenBuffer;
+
 class FunctionParser
 {
 public:
@@ -42,13 +45,35 @@ public:
 
     typedef QList<QSharedPointer<Function>> FunctionList;
 
-    static FunctionList parseFunctions(const QString &text);
-    static FunctionList parseFunctionsInFileNoRecursion(const QString &path);
-    static FunctionList parseFunctionsInFile(const QString &path);
+    // a string passed to require or include, or assigned to package.path
+    struct Import
+    {
+        enum Kind
+        {
+            Require,
+            Include,
+            PackagePath,
+        };
+
+        Kind kind;
+        QString name;
+        int line;
+    };
 
-    static QStringList findDependencies(const QString &path);
-    static QStringList parseRequiredFiles(QFile &ifile);
-    static QString requireExists(QDir directory, QStringList packagePaths, QString require);
+    static FunctionList parseFunctions(const QString &text);
+    // text tokenized into tokens, starting at line firstLine (0-based)
+    static FunctionList parseFunctions(const QString &text, const TokenBuffer &tokens, int firstLine);
+    static FunctionList parseFunctions(const SourceFile &source);
+    // functions of the files path requires and of the Lua library, from the ModuleGraph
+    static FunctionList parseDependencyFunctions(const QString &path);
+
+    // the imports of source in one pass over its tokens, strings in comments are skipped
+    static QVector<Import> parseImports(const SourceFile &source);
+    // the files the imports of fileName refer to
+    static QStringList resolveImports(const QString &fileName, const QVector<Import> &imports);
+    // the directories listed to find it are added to listedDirectories
+    static QString requireExists(QDir directory, QStringList packagePaths, QString require,
+                                 QStringList *listedDirectories = nullptr);
 
     static void addLuaLibraryCalls(FunctionList &list);
 };
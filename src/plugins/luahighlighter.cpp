@@ -13,13 +13,47 @@
 */
 
 #include "luahighlighter.h"
-#include "scanner/luascanner.h"
+#include "scanner/luablockdata.h"
 #include "scanner/luaformattoken.h"
+#include "scanner/luaprescan.h"
+#include "scanner/luascanner.h"
+#include <utils/runextensions.h>
+#include <QElapsedTimer>
+#include <QTextDocument>
+#include <QThread>
+
+enum {
+    // documents with more blocks are highlighted viewport first. Scanning a
+    // block takes about 1.4 us (see benchmarkBlockScan), 27 ms for 20000
+    // blocks; that leaves most of a 100 ms budget for the first paint to
+    // setting the formats, which the benchmark doesn't measure
+    LARGE_DOCUMENT_BLOCK_COUNT = 20000,
+    // blocks above and below the visible ones that are highlighted right away
+    VISIBLE_BLOCKS_MARGIN = 200,
+    // blocks highlighted per rehighlightBlock() call of the background pass
+    PENDING_CHUNK_BLOCK_COUNT = 500,
+    // time the background pass may take before yielding to the event loop
+    PENDING_TIME_SLICE_MS = 8
+};
 
 namespace LuaEditor { namespace Internal {
 
 LuaHighlighter::LuaHighlighter()
+    : m_pendingBlock(0),
+      m_windowFirst(0),
+      m_windowLast(VISIBLE_BLOCKS_MARGIN),
+      m_chunkFirst(-1),
+      m_chunkLast(-1),
+      m_preScanRevision(-1),
+      m_preScanStarted(false)
 {
+    m_pendingTimer.setSingleShot(true);
+    m_pendingTimer.setInterval(0);
+    connect(&m_pendingTimer, &QTimer::timeout, this, &LuaHighlighter::highlightPending);
+    m_snapshotTimer.setSingleShot(true);
+    m_snapshotTimer.setInterval(0);
+    connect(&m_snapshotTimer, &QTimer::timeout, this, &LuaHighlighter::continueSnapshot);
+    connect(&m_preScanWatcher, &QFutureWatcherBase::finished, this, &LuaHighlighter::preScanFinished);
 
     static QVector<TextEditor::TextStyle> categories;
     if(categories.isEmpty()) {
@@ -59,53 +93,193 @@ LuaHighlighter::LuaHighlighter()
 }
 void LuaHighlighter::highlightBlock(QString const& text)
 {
+    QTextBlock block = currentBlock();
+    if(isDeferred(block))
+    {
+        // leave it to highlightPending(), the state stays -1
+        setCurrentBlockState(-1);
+        m_pendingBlock = qMin(m_pendingBlock, block.blockNumber());
+        if(!m_pendingTimer.isActive())
+            m_pendingTimer.start();
+        if(!m_preScanStarted)
+            startPreScan();
+        return;
+    }
+
+    PreScan const* pre = preScan();
+    int number = block.blockNumber();
+
     int initialState = previousBlockState();
     if(initialState == -1)
-        initialState = 0;
-    setCurrentBlockState(highlightLine(text, initialState));
+        initialState = pre ? pre->lineInitialState(number) : Scanner::StateAfterBlock(block.previous());
+
+    LuaBlockData* data = LuaBlockData::attach(block);
+    if(pre && pre->lineInitialState(number) == initialState)
+        data->assign(text, block.revision(), initialState, *pre, number);
+    else
+        data->scan(text, block.revision(), initialState);
+
+    highlightLine(text, *data);
+    setCurrentBlockState(data->m_endState);
 }
 
-static bool isImportKeyword(QString const& keyword)
+static bool isImportKeyword(QStringRef const& keyword)
 {
     return keyword == QLatin1String("require");
 }
 
-int LuaHighlighter::highlightLine(QString const& text, int initialState)
+void LuaHighlighter::highlightLine(QString const& text, LuaBlockData const& data)
 {
-    Scanner scanner(text.constData(),text.length());
-    scanner.setState(initialState);
-
-    FormatToken tk;
     bool hasOnlyWhitespace = true;
-    while((tk = scanner.read()).format() != Format_EndOfBlock)
+    bool isImport = false;
+    TokenBuffer const& tokens = data.m_tokens;
+    for(int i = 0; i < tokens.size(); ++i)
     {
-        Format format = tk.format();
-        if(format == Format_Keyword) {
-            if(isImportKeyword(scanner.value(tk)) && hasOnlyWhitespace)
-            {
-                setFormat(tk.begin(), tk.length(), formatForCategory(format));
-                highlightImport(scanner);
-                break;
-            }
+        Format format = tokens.format(i);
+        if(isImport)
+        {
+            if(format == Format_Identifier)
+                format = Format_RequiredModule;
+        }
+        else if(format == Format_Keyword)
+        {
+            if(isImportKeyword(text.midRef(tokens.begin(i), tokens.length(i))) && hasOnlyWhitespace)
+                isImport = true;
         }
 
-        setFormat(tk.begin(), tk.length(), formatForCategory(format));
+        setFormat(tokens.begin(i), tokens.length(i), formatForCategory(format));
         if(format != Format_Whitespace)
             hasOnlyWhitespace = false;
     }
-    return scanner.state();
 }
 
-void LuaHighlighter::highlightImport(Scanner& scanner)
+void LuaHighlighter::setVisibleBlocks(int first, int last)
+{
+    m_windowFirst = first - VISIBLE_BLOCKS_MARGIN;
+    m_windowLast = last + VISIBLE_BLOCKS_MARGIN;
+    highlightWindow();
+}
+
+bool LuaHighlighter::isDeferred(QTextBlock const& block) const
+{
+    if(block.userState() != -1 || document()->blockCount() <= LARGE_DOCUMENT_BLOCK_COUNT)
+        return false;
+
+    int number = block.blockNumber();
+    return (number < m_windowFirst || number > m_windowLast)
+        && (number < m_chunkFirst || number > m_chunkLast);
+}
+
+void LuaHighlighter::highlightWindow()
+{
+    QTextDocument* doc = document();
+    if(!doc || doc->blockCount() <= LARGE_DOCUMENT_BLOCK_COUNT)
+        return;
+
+    // highlighting a pending block continues with the following ones
+    // in the window, as its state changes from -1
+    QTextBlock block = doc->findBlockByNumber(qMax(m_windowFirst, 0));
+    while(block.isValid() && block.blockNumber() <= m_windowLast)
+    {
+        if(block.userState() == -1)
+            rehighlightBlock(block);
+        block = block.next();
+    }
+}
+
+void LuaHighlighter::highlightPending()
+{
+    QTextDocument* doc = document();
+    if(!doc)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QTextBlock block = doc->findBlockByNumber(m_pendingBlock);
+    while(block.isValid())
+    {
+        if(block.userState() != -1)
+        {
+            block = block.next();
+            continue;
+        }
+
+        if(timer.elapsed() >= PENDING_TIME_SLICE_MS)
+        {
+            m_pendingBlock = block.blockNumber();
+            m_pendingTimer.start();
+            return;
+        }
+
+        // as each block's state changes from -1, rehighlightBlock() goes on
+        // through the chunk, and on into blocks that were highlighted early
+        // if their incoming state changed
+        m_chunkFirst = block.blockNumber();
+        m_chunkLast = m_chunkFirst + PENDING_CHUNK_BLOCK_COUNT - 1;
+        rehighlightBlock(block);
+        m_chunkFirst = m_chunkLast = -1;
+
+        block = block.next();
+    }
+    m_pendingBlock = doc->blockCount();
+}
+
+void LuaHighlighter::startPreScan()
+{
+    m_preScanStarted = true;
+    m_preScanRevision = document()->revision();
+    m_snapshot.clear();
+    m_snapshot.reserve(document()->blockCount());
+    m_snapshotTimer.start();
+}
+
+void LuaHighlighter::continueSnapshot()
 {
-    FormatToken tk;
-    while((tk = scanner.read()).format() != Format_EndOfBlock)
+    QTextDocument* doc = document();
+    // the pre-scan is only used until the document is edited
+    if(!doc || doc->revision() != m_preScanRevision)
     {
-        Format format = tk.format();
-        if(format == Format_Identifier)
-            format = Format_RequiredModule;
-        setFormat(tk.begin(), tk.length(), formatForCategory(format));
+        m_snapshot.clear();
+        return;
     }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for(QTextBlock block = doc->findBlockByNumber(m_snapshot.size()); block.isValid(); block = block.next())
+    {
+        if(timer.elapsed() >= PENDING_TIME_SLICE_MS)
+        {
+            m_snapshotTimer.start();
+            return;
+        }
+        m_snapshot.push_back(block.text());
+    }
+
+    m_preScanWatcher.setFuture(Utils::runAsync(&PreScan::createFromLines, m_snapshot,
+                                               QThread::idealThreadCount()));
+    m_snapshot.clear();
+}
+
+void LuaHighlighter::preScanFinished()
+{
+    QFuture<QSharedPointer<PreScan>> future = m_preScanWatcher.future();
+    if(future.resultCount() == 0 || !document() || document()->revision() != m_preScanRevision)
+        return;
+
+    // a line separator inside a block doesn't start a line of the pre-scan,
+    // but check that there is a line for every block anyway
+    QSharedPointer<PreScan> result = future.result();
+    if(result->lineCount() == document()->blockCount())
+        m_preScan = result;
+}
+
+PreScan const* LuaHighlighter::preScan()
+{
+    if(m_preScan && document()->revision() != m_preScanRevision)
+        m_preScan.reset();
+    return m_preScan.data();
 }
 
 } }
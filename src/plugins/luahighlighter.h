@@ -16,22 +16,63 @@
 #define LUAHIGHLIGHTER_H
 #include "luaeditor_global.h"
 #include <texteditor/syntaxhighlighter.h>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTimer>
 
 namespace LuaEditor { namespace Internal {
 
-class Scanner;
+class LuaBlockData;
+class PreScan;
 
+// In large documents, blocks that were never highlighted are only highlighted
+// right away if they are visible or close to it, see setVisibleBlocks(). The
+// others keep userState() -1 and are highlighted in order by a time-sliced
+// background pass, which also carries the scanner state past the blocks that
+// were highlighted early. Large documents are also scanned in parallel when
+// they are opened, see PreScan; until the document is edited, its tokens and
+// states are used instead of scanning blocks on the GUI thread.
 class LuaHighlighter : public TextEditor::SyntaxHighlighter
 {
 public:
 	LuaHighlighter();
 	
+	// block numbers of the first and last visible block
+	void setVisibleBlocks(int first, int last);
+	
 protected:
 	void highlightBlock(QString const& text);
 	
 private:
-	int highlightLine(QString const& text, int initialState);
-	void highlightImport(Scanner& scanner);
+	void highlightLine(QString const& text, LuaBlockData const& data);
+	
+	bool isDeferred(QTextBlock const& block) const;
+	void highlightWindow();
+	void highlightPending();
+	
+	void startPreScan();
+	// copies the text of the blocks for the pre-scan in time slices
+	void continueSnapshot();
+	void preScanFinished();
+	// the pre-scan result if the document hasn't changed since
+	PreScan const* preScan();
+	
+	QTimer m_pendingTimer;
+	// blocks before m_pendingBlock have all been highlighted
+	int m_pendingBlock;
+	// block numbers highlighted right away, [first, last]
+	int m_windowFirst;
+	int m_windowLast;
+	int m_chunkFirst;
+	int m_chunkLast;
+	
+	QTimer m_snapshotTimer;
+	QStringList m_snapshot;
+	QFutureWatcher<QSharedPointer<PreScan>> m_preScanWatcher;
+	QSharedPointer<PreScan> m_preScan;
+	int m_preScanRevision;
+	bool m_preScanStarted;
 };
 
 } }
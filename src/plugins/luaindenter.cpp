@@ -13,28 +13,13 @@
 */
 
 #include "luaindenter.h"
-#include "scanner/luascanner.h"
+#include "scanner/luablockdata.h"
 
 #include <texteditor/tabsettings.h>
-#include <QSet>
 #include <QString>
 
 namespace LuaEditor { namespace Internal {
 
-static QSet<QString> const g_increaseKeywords = {
-    QStringLiteral("function"),
-    QStringLiteral("do"),
-    QStringLiteral("then"),
-    QStringLiteral("else"),
-    QStringLiteral("repeat")
-};
-static QSet<QString> const g_decreaseKeywords = {
-    QStringLiteral("end"),
-    QStringLiteral("until"),
-    QStringLiteral("elseif"),
-    QStringLiteral("else"),
-};
-
 LuaIndenter::LuaIndenter(QTextDocument *doc)
     : TextEditor::TextIndenter(doc)
 {}
@@ -42,7 +27,7 @@ LuaIndenter::LuaIndenter(QTextDocument *doc)
 LuaIndenter::~LuaIndenter(){}
 
 bool LuaIndenter::isElectricCharacter(QChar const& ch) const {
-    for(const QString &decreaseKeyword : g_decreaseKeywords){
+    for(const QString &decreaseKeyword : LuaBlockData::indentDecreasingKeywords()){
         if(decreaseKeyword.at(decreaseKeyword.length()-1) == ch)
             return true;
     }
@@ -57,7 +42,7 @@ void LuaIndenter::indentBlock(const QTextBlock &block,
     Q_UNUSED(typedChar);
 
     // If unindent keyword detected, do an unindentation run
-    for(const QString &decreaseKeyword: g_decreaseKeywords){
+    for(const QString &decreaseKeyword: LuaBlockData::indentDecreasingKeywords()){
         if(block.text().endsWith(decreaseKeyword)){
             unindentBlockIfNecessary(block, tabSettings);
             return;
@@ -93,7 +78,7 @@ void LuaIndenter::indentBlock(const QTextBlock &block,
     tabSettings.indentLine(block,
         qMax<int>(0,
             previousIndentation
-            + qMax(0, getLineDelta(previousBlockText)) * tabSettings.m_indentSize
+            + qMax(0, getLineDelta(previousBlock)) * tabSettings.m_indentSize
         )
     );
 }
@@ -101,56 +86,30 @@ void LuaIndenter::indentBlock(const QTextBlock &block,
 void LuaIndenter::unindentBlockIfNecessary(const QTextBlock &block,
                         const TextEditor::TabSettings &tabSettings){
 
+    LuaBlockData const* data = LuaBlockData::get(block);
+
     // Skip if it wasn't actually a real keyword (e.g. keyword-like text in a string)
-    if(!g_decreaseKeywords.contains(getLastKeyword(block.text())))
+    if(!LuaBlockData::isIndentDecreasingKeyword(data->m_lastKeyword))
         return;
 
-    // Get the minimum depth in the current block
-    bool isSelfContained = true;
-    int depth = 0;
-    for(const QString &keyword : getAllKeywords(block.text())){
-        // Check decrease first to catch 'else'
-        if(g_decreaseKeywords.contains(keyword)){
-            depth--;
-            if(depth < 0){
-                isSelfContained = false;
-            }
-        }
-        if(g_increaseKeywords.contains(keyword)){
-            depth++;
-        }
-    }
-
-    // Don't unindent if the corresponding opening keyword was in the same line
-    if(isSelfContained)
+    // Don't unindent if the corresponding opening keyword was in the same line,
+    // i.e. the depth never drops below zero while walking through the line
+    if(data->m_keywordMinDelta >= 0)
         return;
 
-    // Reset depth
-    depth = 0;
-
     // Iterate through previous lines to find starting keyword that is connected
-    // to the current ending keyword
+    // to the current ending keyword. Walking a line backwards, its keywords
+    // close 'depth' pending blocks before it opens a new one as soon as the
+    // depth drops below zero, which happens iff depth < getLineDelta(line).
+    int depth = 0;
     QTextBlock nextBlock = block.previous();
     while(nextBlock.isValid()){
-        QVector<QString> keywords = getAllKeywords(nextBlock.text());
-
-        bool isCorrespondingBlock = false;
-
-        for(auto it = keywords.rbegin(); it != keywords.rend(); it++){
-            if(g_increaseKeywords.contains(*it)){
-                depth--;
-                if(depth < 0){
-                    isCorrespondingBlock = true;
-                }
-            }
-            if(g_decreaseKeywords.contains(*it)){
-                depth++;
-            }
-        }
+        LuaBlockData const* previousData = LuaBlockData::get(nextBlock);
 
-        if(isCorrespondingBlock)
+        if(depth < previousData->m_keywordDelta - previousData->m_keywordMinDelta)
             break;
 
+        depth -= previousData->m_keywordDelta;
         nextBlock = nextBlock.previous();
     }
 
@@ -165,65 +124,16 @@ void LuaIndenter::unindentBlockIfNecessary(const QTextBlock &block,
     tabSettings.indentLine(block, newIndentation);
 }
 
-QVector<QString> LuaIndenter::getAllKeywords(const QString &line) const
+int LuaIndenter::getLineDelta(const QTextBlock &block) const
 {
-    QVector<QString> keywords;
-
-    FormatToken thisToken;
-    Scanner scannerA(line.constData(),line.size());
-    while((thisToken = scannerA.read()).format() != Format_EndOfBlock)
-    {
-        if(thisToken.format() == Format_Keyword)
-            keywords.push_back(scannerA.value(thisToken));
-    }
-
-    return keywords;
-}
-
-QString LuaIndenter::getLastKeyword(const QString &line) const
-{
-    QString lastKeyword;
-    
-    FormatToken thisToken;
-    Scanner scannerA(line.constData(),line.size());
-    while((thisToken = scannerA.read()).format() != Format_EndOfBlock)
-    {
-        if(thisToken.format() == Format_Keyword)
-            lastKeyword = scannerA.value(thisToken);
-    }
-    return lastKeyword;
-}
-
-int LuaIndenter::getLineDelta(const QString& line) const
-{
-    if (line.length() == 0) return 0;
-
-    int delta = 0;
-    int minDelta = 0;
-
-    FormatToken thisToken;
-    Scanner scannerA(line.constData(),line.size());
-    while((thisToken = scannerA.read()).format() != Format_EndOfBlock)
-    {
-        if(thisToken.format() == Format_Keyword){
-            const QString keyword = scannerA.value(thisToken);
-            // Decrease first, to catch 'else'
-            if(g_decreaseKeywords.contains(keyword)){
-                delta--;
-                if(delta < minDelta)
-                    minDelta = delta;
-            }
-            if(g_increaseKeywords.contains(keyword))
-                delta++;
-        }
-    }
+    LuaBlockData const* data = LuaBlockData::get(block);
 
     // Return how much the end depth is higher than the minimum depth.
     // examples:
     // 'else' => 1
     // 'do' => 1
     // 'if a then b end' => 0
-    return delta-minDelta;
+    return data->m_keywordDelta - data->m_keywordMinDelta;
 }
 
 } }
@@ -36,9 +36,7 @@ public:
     virtual void unindentBlockIfNecessary(const QTextBlock &block,
                  const TextEditor::TabSettings &tabSettings);
 protected:
-    QString getLastKeyword(QString const& line) const;
-    QVector<QString> getAllKeywords(const QString &line) const;
-    int getLineDelta(QString const& line) const;
+    int getLineDelta(QTextBlock const& block) const;
 };
 
 } }
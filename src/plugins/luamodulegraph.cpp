@@ -0,0 +1,475 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luamodulegraph.h"
+#include "scanner/luasourcefile.h"
+#include <projectexplorer/project.h>
+#include <projectexplorer/session.h>
+#include <utils/hostosinfo.h>
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QVector>
+
+namespace LuaEditor { namespace Internal {
+
+namespace {
+
+// what is read from one file
+struct ModuleContents
+{
+    bool exists = false;
+    QVector<FunctionParser::Import> imports;
+    QStringList requires;
+    // the resolution revision requires was resolved at
+    int resolution = 0;
+    FunctionParser::FunctionList functions;
+};
+
+struct Module
+{
+    // increases with every invalidation, reads started before are dropped
+    int version = 0;
+    bool read = false;
+    ModuleContents contents;
+    // the files whose requires resolved to this one
+    QSet<QString> requiredBy;
+
+    bool closureValid = false;
+    int closureResolution = 0;
+    FunctionParser::FunctionList dependencyFunctions;
+};
+
+}
+
+static QMutex g_modulesMutex;
+static QHash<QString, Module> g_modules;
+static QAtomicInt g_revision;
+static ModuleGraphWatcher *g_watcher = nullptr;
+
+// resolved requires, the directories listed for them and directory
+// listings, dropped when a listed directory changes; the revision increases
+// then and when the search roots change
+static QMutex g_resolutionMutex;
+static QHash<QString, QString> g_resolutions;
+static QHash<QString, QSet<QString>> g_resolutionsByDirectory;
+static QHash<QString, QSet<QString>> g_listings;
+static QStringList g_searchRoots;
+static QAtomicInt g_resolutionRevision;
+
+// names of directory listings are compared case insensitively where file
+// names are
+static QString listingName(const QString &name)
+{
+    return Utils::HostOsInfo::fileNameCaseSensitivity() == Qt::CaseInsensitive ? name.toCaseFolded() : name;
+}
+
+// the directory of a clean path; "/x.lua" is in "/" and "C:/x.lua" in "C:/"
+static QString directoryOf(const QString &cleanPath)
+{
+    QString directory = cleanPath.left(qMax(cleanPath.lastIndexOf(QChar('/')), 0));
+    if (directory.isEmpty() || directory.endsWith(QChar(':')))
+        directory += QChar('/');
+    return directory;
+}
+
+static void watch(const QString &path)
+{
+    QMutexLocker locker(&g_modulesMutex);
+    if (g_watcher)
+        g_watcher->watch(path);
+}
+
+static ModuleContents readModule(const QString &path)
+{
+    ModuleContents contents;
+    contents.resolution = g_resolutionRevision.loadAcquire();
+
+    SourceFile source;
+    contents.exists = source.open(path);
+    if (contents.exists)
+    {
+        contents.imports = FunctionParser::parseImports(source);
+        contents.requires = FunctionParser::resolveImports(path, contents.imports);
+        contents.functions = FunctionParser::parseFunctions(source);
+    }
+
+    return contents;
+}
+
+// drops the closures containing path
+static void invalidateClosures(const QString &path)
+{
+    QSet<QString> visited = {path};
+    QStringList todo = {path};
+    while (!todo.isEmpty())
+    {
+        Module &module = g_modules[todo.takeFirst()];
+        module.closureValid = false;
+        module.dependencyFunctions.clear();
+
+        for (const QString &dependent : module.requiredBy)
+        {
+            if (!visited.contains(dependent))
+            {
+                visited.insert(dependent);
+                todo.push_back(dependent);
+            }
+        }
+    }
+}
+
+static void storeModule(const QString &path, int version, const ModuleContents &contents)
+{
+    Module &module = g_modules[path];
+    // read by another thread, or changed while it was read
+    if (module.read || module.version != version)
+        return;
+
+    module.read = true;
+    module.contents = contents;
+
+    // inserting may move module
+    for (const QString &required : contents.requires)
+        g_modules[required].requiredBy.insert(path);
+
+    if (contents.exists && g_watcher)
+        g_watcher->watch(path);
+}
+
+// the requires of path resolved again after a directory changed
+static void storeRequires(const QString &path, int version, int resolution, const QStringList &requires)
+{
+    Module &module = g_modules[path];
+    if (!module.read || module.version != version)
+        return;
+
+    QStringList previous = module.contents.requires;
+    module.contents.requires = requires;
+    module.contents.resolution = resolution;
+    if (previous == requires)
+        return;
+
+    for (const QString &required : previous)
+        g_modules[required].requiredBy.remove(path);
+    for (const QString &required : requires)
+        g_modules[required].requiredBy.insert(path);
+
+    invalidateClosures(path);
+}
+
+// Makes the closure of path valid. The files that haven't been read yet,
+// or whose requires were resolved before a directory changed, are read or
+// resolved without holding the lock, which is held again on return.
+static const Module &updateClosure(const QString &path, QMutexLocker &locker)
+{
+    for (;;)
+    {
+        int resolution = g_resolutionRevision.loadAcquire();
+        if (g_modules[path].closureValid && g_modules[path].closureResolution == resolution)
+            return g_modules[path];
+
+        QStringList closure;
+        QStringList unread;
+        QStringList unresolved;
+        QSet<QString> visited = {path};
+        QStringList todo = {path};
+        while (!todo.isEmpty())
+        {
+            QString current = todo.takeFirst();
+            const Module &module = g_modules[current];
+            if (!module.read)
+            {
+                unread.push_back(current);
+                continue;
+            }
+            if (!module.contents.exists)
+                continue;
+            if (module.contents.resolution != resolution)
+            {
+                unresolved.push_back(current);
+                continue;
+            }
+
+            closure.push_back(current);
+            for (const QString &required : module.contents.requires)
+            {
+                if (!visited.contains(required))
+                {
+                    visited.insert(required);
+                    todo.push_back(required);
+                }
+            }
+        }
+
+        if (unread.isEmpty() && unresolved.isEmpty())
+        {
+            Module &root = g_modules[path];
+            root.dependencyFunctions.clear();
+            for (const QString &file : closure)
+            {
+                if (file != path)
+                    root.dependencyFunctions.append(g_modules[file].contents.functions);
+            }
+            FunctionParser::addLuaLibraryCalls(root.dependencyFunctions);
+            root.closureValid = true;
+            root.closureResolution = resolution;
+            return root;
+        }
+
+        QVector<int> versions;
+        for (const QString &file : unread)
+            versions.push_back(g_modules[file].version);
+        QVector<int> resolvedVersions;
+        QVector<QVector<FunctionParser::Import>> imports;
+        for (const QString &file : unresolved)
+        {
+            resolvedVersions.push_back(g_modules[file].version);
+            imports.push_back(g_modules[file].contents.imports);
+        }
+
+        locker.unlock();
+        QVector<ModuleContents> contents;
+        for (const QString &file : unread)
+            contents.push_back(readModule(file));
+        QVector<QStringList> requires;
+        for (int i = 0; i < unresolved.size(); ++i)
+            requires.push_back(FunctionParser::resolveImports(unresolved.at(i), imports.at(i)));
+        locker.relock();
+
+        for (int i = 0; i < unread.size(); ++i)
+            storeModule(unread.at(i), versions.at(i), contents.at(i));
+        for (int i = 0; i < unresolved.size(); ++i)
+            storeRequires(unresolved.at(i), resolvedVersions.at(i), resolution, requires.at(i));
+    }
+}
+
+ModuleGraph::FunctionList ModuleGraph::dependencyFunctions(const QString &path)
+{
+    QMutexLocker locker(&g_modulesMutex);
+    return updateClosure(path, locker).dependencyFunctions;
+}
+
+void ModuleGraph::invalidate(const QString &path)
+{
+    QMutexLocker locker(&g_modulesMutex);
+    auto it = g_modules.find(path);
+    if (it == g_modules.end())
+        return;
+
+    // the edges to the required files are resolved again with the file
+    for (const QString &required : it->contents.requires)
+    {
+        auto requiredIt = g_modules.find(required);
+        if (requiredIt != g_modules.end())
+            requiredIt->requiredBy.remove(path);
+    }
+
+    ++it->version;
+    it->read = false;
+    it->contents = ModuleContents();
+
+    invalidateClosures(path);
+    g_revision.fetchAndAddOrdered(1);
+}
+
+QString ModuleGraph::resolve(const QDir &directory, const QStringList &packagePaths, const QString &require)
+{
+    QString key = directory.absolutePath() + QChar('\n') + packagePaths.join(QChar(';')) + QChar('\n') + require;
+    {
+        QMutexLocker locker(&g_resolutionMutex);
+        auto it = g_resolutions.constFind(key);
+        if (it != g_resolutions.constEnd())
+            return *it;
+    }
+
+    int resolution = g_resolutionRevision.loadAcquire();
+    QStringList listed;
+    QString path = FunctionParser::requireExists(directory, packagePaths, require, &listed);
+
+    QMutexLocker locker(&g_resolutionMutex);
+    // a directory may have changed in the meantime
+    if (resolution == g_resolutionRevision.loadAcquire())
+    {
+        g_resolutions.insert(key, path);
+        for (const QString &listedDirectory : listed)
+            g_resolutionsByDirectory[listedDirectory].insert(key);
+    }
+    return path;
+}
+
+bool ModuleGraph::isFile(const QString &path, QString *listedDirectory)
+{
+    QString cleanPath = QDir::cleanPath(path);
+    QString directory = directoryOf(cleanPath);
+    QString name = listingName(cleanPath.mid(cleanPath.lastIndexOf(QChar('/')) + 1));
+
+    {
+        QMutexLocker locker(&g_resolutionMutex);
+        auto it = g_listings.constFind(directory);
+        if (it != g_listings.constEnd())
+        {
+            if (listedDirectory)
+                *listedDirectory = directory;
+            return it->contains(name);
+        }
+    }
+
+    // missing directories aren't listed, the nearest existing one changes
+    // when they are created
+    QDir dir(directory);
+    if (!dir.exists())
+    {
+        QString existing = directoryOf(directory);
+        while (!QDir(existing).exists() && existing != directoryOf(existing))
+            existing = directoryOf(existing);
+        if (listedDirectory)
+            *listedDirectory = existing;
+        watch(existing);
+        return false;
+    }
+
+    QSet<QString> listing;
+    for (const QString &entry : dir.entryList(QDir::Files | QDir::Hidden | QDir::System))
+        listing.insert(listingName(entry));
+    bool found = listing.contains(name);
+
+    {
+        QMutexLocker locker(&g_resolutionMutex);
+        g_listings.insert(directory, listing);
+    }
+    watch(directory);
+
+    if (listedDirectory)
+        *listedDirectory = directory;
+    return found;
+}
+
+void ModuleGraph::invalidateDirectory(const QString &directory)
+{
+    {
+        QMutexLocker locker(&g_resolutionMutex);
+        g_listings.remove(directory);
+        // the other requires are resolved again from the cache
+        for (const QString &key : g_resolutionsByDirectory.take(directory))
+            g_resolutions.remove(key);
+        g_resolutionRevision.fetchAndAddOrdered(1);
+    }
+
+    {
+        // files read while they were missing may have been created
+        QMutexLocker locker(&g_modulesMutex);
+        QStringList missing;
+        for (auto it = g_modules.cbegin(); it != g_modules.cend(); ++it)
+        {
+            if (it->read && !it->contents.exists && QFileInfo(it.key()).absolutePath() == directory)
+                missing.push_back(it.key());
+        }
+
+        for (const QString &path : missing)
+        {
+            Module &module = g_modules[path];
+            ++module.version;
+            module.read = false;
+            invalidateClosures(path);
+        }
+    }
+
+    g_revision.fetchAndAddOrdered(1);
+}
+
+void ModuleGraph::setSearchRoots(const QStringList &roots)
+{
+    {
+        QMutexLocker locker(&g_resolutionMutex);
+        g_searchRoots.clear();
+        for (const QString &root : roots)
+            g_searchRoots.push_back(QDir::cleanPath(root));
+        // the requires of every file are resolved again
+        g_resolutionRevision.fetchAndAddOrdered(1);
+    }
+
+    g_revision.fetchAndAddOrdered(1);
+}
+
+QString ModuleGraph::searchRoot(const QString &fileName)
+{
+    QString file = QDir::cleanPath(QFileInfo(fileName).absoluteFilePath());
+    QString directory = directoryOf(file);
+
+    QMutexLocker locker(&g_resolutionMutex);
+    QString root;
+    for (const QString &searchRoot : g_searchRoots)
+    {
+        QString prefix = searchRoot.endsWith(QChar('/')) ? searchRoot : searchRoot + QChar('/');
+        if ((root.isEmpty() || searchRoot.size() < root.size())
+                && (directory + QChar('/')).startsWith(prefix, Utils::HostOsInfo::fileNameCaseSensitivity()))
+            root = directory.left(searchRoot.size());
+    }
+    return root.isEmpty() ? directory : root;
+}
+
+int ModuleGraph::revision()
+{
+    return g_revision.loadAcquire();
+}
+
+ModuleGraphWatcher::ModuleGraphWatcher()
+{
+    QObject::connect(&m_fileWatcher, &QFileSystemWatcher::fileChanged, &m_fileWatcher, [this](const QString &path) {
+        // editors that save by replacing the file drop it from the watcher,
+        // it's watched again when it's read again
+        m_fileWatcher.removePath(path);
+        ModuleGraph::invalidate(path);
+    });
+    QObject::connect(&m_fileWatcher, &QFileSystemWatcher::directoryChanged, &m_fileWatcher, [this](const QString &path) {
+        // watched again when it's listed again
+        m_fileWatcher.removePath(path);
+        ModuleGraph::invalidateDirectory(path);
+    });
+
+    auto updateSearchRoots = []() {
+        QStringList roots;
+        for (ProjectExplorer::Project *project : ProjectExplorer::SessionManager::projects())
+            roots.push_back(project->projectDirectory().toString());
+        ModuleGraph::setSearchRoots(roots);
+    };
+    QObject::connect(ProjectExplorer::SessionManager::instance(), &ProjectExplorer::SessionManager::projectAdded,
+                     &m_fileWatcher, updateSearchRoots);
+    QObject::connect(ProjectExplorer::SessionManager::instance(), &ProjectExplorer::SessionManager::projectRemoved,
+                     &m_fileWatcher, updateSearchRoots);
+    updateSearchRoots();
+
+    QMutexLocker locker(&g_modulesMutex);
+    g_watcher = this;
+}
+
+ModuleGraphWatcher::~ModuleGraphWatcher()
+{
+    QMutexLocker locker(&g_modulesMutex);
+    g_watcher = nullptr;
+}
+
+void ModuleGraphWatcher::watch(const QString &path)
+{
+    // the file watcher belongs to the GUI thread
+    QMetaObject::invokeMethod(&m_fileWatcher, [this, path]() { m_fileWatcher.addPath(path); }, Qt::QueuedConnection);
+}
+
+} }
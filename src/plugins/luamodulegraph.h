@@ -0,0 +1,84 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUAEDITORMODULEGRAPH_H
+#define LUAEDITORMODULEGRAPH_H
+
+#include <QDir>
+#include <QFileSystemWatcher>
+#include <QString>
+#include <QStringList>
+
+#include "luafunctionparser.h"
+
+namespace LuaEditor { namespace Internal {
+
+// The Lua files read for completion, with the files they require resolved
+// and the files requiring them. Every file is read once; the functions
+// visible from a file are collected over the files it requires, directly or
+// not, the first time they are asked for. A changed file drops what was read
+// from it and the collected functions of the files requiring it, directly or
+// not, nothing else. Requires are resolved against cached directory
+// listings; when a listed directory changes, the requires are resolved again
+// from the imports kept with the files. Used from worker threads.
+class ModuleGraph
+{
+public:
+    typedef FunctionParser::FunctionList FunctionList;
+
+    // functions of the files path requires, directly or not, and of the Lua
+    // library; files that don't exist are left out
+    static FunctionList dependencyFunctions(const QString &path);
+
+    // path is read again the next time it's needed
+    static void invalidate(const QString &path);
+    // increases with every invalidation
+    static int revision();
+
+    // FunctionParser::requireExists, cached until a directory it listed changes
+    static QString resolve(const QDir &directory, const QStringList &packagePaths, const QString &require);
+    // whether path is a file, looked up in a cached listing of its directory;
+    // listedDirectory is set to the directory that is watched for it, the
+    // nearest existing one if its directory is missing
+    static bool isFile(const QString &path, QString *listedDirectory = nullptr);
+    // the requires resolved through directory and the files of it that were
+    // missing are resolved and read again the next time they're needed
+    static void invalidateDirectory(const QString &directory);
+
+    // the directories of the open projects; the requires of a file are looked
+    // up from its directory up to the outermost of them containing it, or
+    // in its directory only if none does
+    static void setSearchRoots(const QStringList &roots);
+    static QString searchRoot(const QString &fileName);
+};
+
+// Invalidates the files and the listed directories of the module graph when
+// they change on disk, and keeps its search roots at the directories of the
+// open projects. Owned by the plugin.
+class ModuleGraphWatcher
+{
+public:
+    ModuleGraphWatcher();
+    ~ModuleGraphWatcher();
+
+    // may be called on any thread
+    void watch(const QString &path);
+
+private:
+    QFileSystemWatcher m_fileWatcher;
+};
+
+} }
+
+#endif
@@ -3,8 +3,11 @@
 #include <QFile>
 #include <QString>
 #include <QFileInfo>
-#include <QFileInfo>
-#include <QDateTime>
+#include <QDir>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <utils/runextensions.h>
 
 namespace LuaEditor { namespace Internal {
 
@@ -44,23 +47,6 @@ void PredefinedDocumentationParser::readMembers(QStringList &words, QMap<QString
     if (!ifile.exists())
         return;
 
-    static QMap<QString, std::tuple<QDateTime, QStringList, QMap<QString, QStringList>>> dates;
-
-    auto it = dates.find(path);
-    if (it != dates.end())
-    {
-        QFileInfo info(path);
-        const QDateTime &read = std::get<0>(*it);
-
-        // if the read happened later than the last modification, it's up to date
-        if (info.lastModified() < read)
-        {
-            words = std::get<1>(*it);
-            members = std::get<2>(*it);
-            return;
-        }
-    }
-
     words.clear();
     members.clear();
 
@@ -92,37 +78,15 @@ void PredefinedDocumentationParser::readMembers(QStringList &words, QMap<QString
     }
 
     addLuaMembers(members);
-
-    // update cache
-    dates[path] = std::make_tuple(QDateTime::currentDateTime(), words, members);
 }
 
-void PredefinedDocumentationParser::readCalls(QStringList &words, QMap<QString, QVector<Function>> &functionsByFunction, QMap<QString, QVector<Function>> &functionsByObject, QString path)
+void PredefinedDocumentationParser::readCalls(QVector<Call> &calls, QString path)
 {
     QFile ifile(path);
     if (!ifile.exists())
         return;
 
-    static QMap<QString, std::tuple<QDateTime, QStringList, QMap<QString, QVector<Function>>, QMap<QString, QVector<Function>>>> dates;
-
-    auto it = dates.find(path);
-    if (it != dates.end())
-    {
-        QFileInfo info(path);
-        const QDateTime &read = std::get<0>(*it);
-
-        // if the read happened later than the last modification, it's up to date
-        if (info.lastModified() < read)
-        {
-            words = std::get<1>(*it);
-            functionsByFunction = std::get<2>(*it);
-            functionsByObject = std::get<3>(*it);
-            return;
-        }
-    }
-
-    words.clear();
-    functionsByFunction.clear();
+    calls.clear();
 
     // read whole content
     ifile.open(QIODevice::ReadOnly | QIODevice::Text);
@@ -138,30 +102,21 @@ void PredefinedDocumentationParser::readCalls(QStringList &words, QMap<QString,
         QStringList parts = str.split("|");
         if (parts.isEmpty()) continue;
 
-        Function function;
-        function.m_functionName = parts.at(0);
+        Call call;
+        call.m_function.m_functionName = parts.at(0);
         if (parts.size() > 1)
-            function.m_returnType = parts.at(1);
+            call.m_function.m_returnType = parts.at(1);
 
         for (int i = 2; i < parts.size(); ++i)
-            function.m_arguments.push_back(parts.at(i));
+            call.m_function.m_arguments.push_back(parts.at(i));
 
-        QString functionNameNoObject = parts.at(0).split(":").back();
+        call.m_shortName = parts.at(0).split(":").back();
 
-        functionsByFunction[functionNameNoObject].push_back(function);
+        call.m_object = parts.at(0).split(":").front();
+        if (call.m_object.contains(" ")) call.m_object = call.m_object.split(" ").back();
 
-        QString object = parts.at(0).split(":").front();
-        if (object.contains(" ")) object = object.split(" ").back();
-
-        function.m_functionName = functionNameNoObject;
-        functionsByObject[object].push_back(function);
-
-        words.push_back(functionNameNoObject);
+        calls.push_back(call);
     }
-
-
-    // update cache
-    dates[path] = std::make_tuple(QDateTime::currentDateTime(), words, functionsByFunction, functionsByObject);
 }
 
 void PredefinedDocumentationParser::readWords(QStringList &out, QString path)
@@ -170,22 +125,6 @@ void PredefinedDocumentationParser::readWords(QStringList &out, QString path)
     if (!ifile.exists())
         return;
 
-    static QMap<QString, std::pair<QDateTime, QStringList>> dates;
-
-    auto it = dates.find(path);
-    if (it != dates.end())
-    {
-        QFileInfo info(path);
-        const QDateTime &read = it->first;
-
-        // if the read happened later than the last modification, it's up to date
-        if (info.lastModified() < read)
-        {
-            out = it->second;
-            return;
-        }
-    }
-
     ifile.open(QIODevice::ReadOnly | QIODevice::Text);
 
     // read whole content
@@ -197,9 +136,104 @@ void PredefinedDocumentationParser::readWords(QStringList &out, QString path)
     out = content.split(QString::fromLatin1("\n"));
     addLuaWords(out);
     out.removeAll(QString(""));
+}
 
-    // update cache
-    dates[path] = std::make_pair(QDateTime::currentDateTime(), out);
+static QMutex g_documentationMutex;
+static PredefinedDocumentation::Ptr g_documentation;
+static QAtomicInt g_documentationRevision;
+
+QString PredefinedDocumentation::directory()
+{
+    return QDir::homePath() + QString::fromLatin1("/.avorion/documentation/completion");
+}
+
+PredefinedDocumentation::Ptr PredefinedDocumentation::build(const QString &directory)
+{
+    QSharedPointer<PredefinedDocumentation> documentation(new PredefinedDocumentation);
+    documentation->m_revision = g_documentationRevision.fetchAndAddOrdered(1) + 1;
+    documentation->m_pack.load(directory, DocumentationPack::cachePath());
+    return documentation;
+}
+
+PredefinedDocumentation::Ptr PredefinedDocumentation::instance()
+{
+    // requested before the background build finished; completion goes on
+    // without the documentation until the watcher publishes it
+    static const Ptr empty(new PredefinedDocumentation);
+
+    QMutexLocker locker(&g_documentationMutex);
+    return g_documentation ? g_documentation : empty;
+}
+
+void PredefinedDocumentation::publish(Ptr documentation)
+{
+    QMutexLocker locker(&g_documentationMutex);
+    // only a newer index replaces the current one
+    if (!g_documentation || g_documentation->m_revision < documentation->m_revision)
+        g_documentation = documentation;
+}
+
+PredefinedDocumentationWatcher::PredefinedDocumentationWatcher()
+{
+    QObject::connect(&m_buildWatcher, &QFutureWatcherBase::finished, &m_buildWatcher, [this]() { buildFinished(); });
+    QObject::connect(&m_fileWatcher, &QFileSystemWatcher::fileChanged, &m_fileWatcher, [this]() { startBuild(); });
+    QObject::connect(&m_fileWatcher, &QFileSystemWatcher::directoryChanged, &m_fileWatcher, [this]() { startBuild(); });
+
+    updateWatchedPaths();
+    startBuild();
+}
+
+PredefinedDocumentationWatcher::~PredefinedDocumentationWatcher()
+{
+    m_buildWatcher.waitForFinished();
+}
+
+void PredefinedDocumentationWatcher::startBuild()
+{
+    // several change notifications for one save are folded into one rebuild
+    if (m_buildWatcher.isRunning())
+    {
+        m_buildPending = true;
+        return;
+    }
+
+    m_buildPending = false;
+    m_buildWatcher.setFuture(Utils::runAsync(&PredefinedDocumentation::build, PredefinedDocumentation::directory()));
+}
+
+void PredefinedDocumentationWatcher::buildFinished()
+{
+    if (m_buildWatcher.future().resultCount() > 0)
+        PredefinedDocumentation::publish(m_buildWatcher.result());
+
+    // editors that save by replacing the file drop it from the watcher
+    updateWatchedPaths();
+
+    if (m_buildPending)
+        startBuild();
+}
+
+void PredefinedDocumentationWatcher::updateWatchedPaths()
+{
+    QString directory = PredefinedDocumentation::directory();
+    QStringList paths;
+
+    if (QFileInfo::exists(directory))
+        paths.push_back(directory);
+
+    for (const char *name : {"words", "members", "calls"})
+    {
+        QString path = directory + QLatin1Char('/') + QString::fromLatin1(name);
+        if (QFileInfo::exists(path))
+            paths.push_back(path);
+    }
+
+    QStringList watched = m_fileWatcher.files() + m_fileWatcher.directories();
+    for (const QString &path : paths)
+    {
+        if (!watched.contains(path))
+            m_fileWatcher.addPath(path);
+    }
 }
 
 } }
@@ -2,9 +2,14 @@
 #define LUAEDITORPREDEFINEDDOCUMENTATIONPARSER_H
 
 #include <QMap>
+#include <QStringList>
 #include <QVector>
+#include <QSharedPointer>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
 
 #include "luafunctionhintproposalmodel.h"
+#include "documentationpack.h"
 
 namespace LuaEditor { namespace Internal {
 
@@ -13,14 +18,64 @@ class PredefinedDocumentationParser
 public:
     typedef LuaFunctionHintProposalModel::Function Function;
 
+    // one line of the calls file
+    struct Call
+    {
+        // m_functionName is the full name, including the object
+        Function m_function;
+        QString m_shortName;
+        QString m_object;
+    };
+
     static void readMembers(QStringList &words, QMap<QString, QStringList> &members, QString path);
-    static void readCalls(QStringList &words, QMap<QString, QVector<Function>> &functionsByFunction, QMap<QString, QVector<Function>> &functionsByObject, QString path);
+    static void readCalls(QVector<Call> &calls, QString path);
     static void readWords(QStringList &out, QString path);
 
     static void addLuaMembers(QMap<QString, QStringList> &members);
     static void addLuaWords(QStringList &words);
 };
 
+// Everything read from the completion documentation directory. An index is
+// never modified after it was built; instance() hands out the current one,
+// which is replaced as a whole when the files change.
+class PredefinedDocumentation
+{
+public:
+    typedef LuaFunctionHintProposalModel::Function Function;
+    typedef QSharedPointer<const PredefinedDocumentation> Ptr;
+
+    DocumentationPack m_pack;
+
+    // increases with every index that is built
+    int m_revision = 0;
+
+    static QString directory();
+    static Ptr build(const QString &directory);
+
+    // the current index, an empty one with revision 0 until the first one
+    // is published
+    static Ptr instance();
+    static void publish(Ptr documentation);
+};
+
+// Builds the index in the background and rebuilds it whenever one of the
+// documentation files changes. Owned by the plugin.
+class PredefinedDocumentationWatcher
+{
+public:
+    PredefinedDocumentationWatcher();
+    ~PredefinedDocumentationWatcher();
+
+private:
+    void startBuild();
+    void buildFinished();
+    void updateWatchedPaths();
+
+    QFileSystemWatcher m_fileWatcher;
+    QFutureWatcher<PredefinedDocumentation::Ptr> m_buildWatcher;
+    bool m_buildPending = false;
+};
+
 } }
 
 #endif
@@ -0,0 +1,439 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luablockdata.h"
+#include "luaprescan.h"
+
+namespace LuaEditor { namespace Internal {
+
+static bool isOpeningBracket(QChar ch)
+{
+	return ch == QLatin1Char('(') || ch == QLatin1Char('[') || ch == QLatin1Char('{');
+}
+
+static bool isClosingBracket(QChar ch)
+{
+	return ch == QLatin1Char(')') || ch == QLatin1Char(']') || ch == QLatin1Char('}');
+}
+
+// adds the brackets of the operator tokens in text before end to openBrackets
+static void collectBrackets(QString const& text, TokenBuffer const& tokens, int end,
+							QVector<LuaBlockData::OpenBracket>& openBrackets, int& unmatchedClosers)
+{
+	for(int i = 0; i < tokens.size() && tokens.begin(i) < end; ++i)
+	{
+		if(tokens.format(i) != Format_Operator)
+			continue;
+		
+		int tokenEnd = qMin(qMin(tokens.end(i), end), text.size());
+		for(int offset = tokens.begin(i); offset < tokenEnd; ++offset)
+		{
+			QChar ch = text.at(offset);
+			if(isOpeningBracket(ch))
+				openBrackets.push_back({offset, ch});
+			else if(!isClosingBracket(ch))
+				continue;
+			else if(!openBrackets.isEmpty())
+				openBrackets.pop_back();
+			else
+				++unmatchedClosers;
+		}
+	}
+}
+
+static bool isSignificant(Format format)
+{
+	return format != Format_Whitespace && format != Format_Comment && format != Format_MLComment;
+}
+
+// what the names following a token declare
+enum DeclarationMode
+{
+	NoDeclaration,
+	LocalNames,
+	FunctionName,
+	Parameters,
+	LoopNames
+};
+
+static void collectScopeEvents(QString const& text, TokenBuffer const& tokens, QVector<LuaBlockData::ScopeEvent>& events)
+{
+	typedef LuaBlockData::ScopeEvent ScopeEvent;
+	
+	QVector<int> significant;
+	for(int i = 0; i < tokens.size(); ++i)
+	{
+		if(isSignificant(tokens.format(i)) && tokens.begin(i) < text.size())
+			significant.push_back(i);
+	}
+	
+	auto tokenText = [&](int index) { return text.mid(tokens.begin(significant.at(index)), tokens.length(significant.at(index))); };
+	auto formatAt = [&](int index) { return index < significant.size() ? tokens.format(significant.at(index)) : Format_EndOfBlock; };
+	auto positionAt = [&](int index) { return tokens.begin(significant.at(index)); };
+	
+	DeclarationMode mode = NoDeclaration;
+	QVector<ScopeEvent> loopNames;
+	
+	for(int n = 0; n < significant.size(); ++n)
+	{
+		int i = significant.at(n);
+		Format format = tokens.format(i);
+		Keyword keyword = tokens.keyword(i);
+		int position = tokens.begin(i);
+		
+		if(format == Format_Local)
+		{
+			mode = LocalNames;
+			continue;
+		}
+		
+		if(format == Format_Keyword)
+		{
+			switch(keyword)
+			{
+			case Keyword_Function:
+				// the name of a function is declared outside of it
+				if(formatAt(n+1) == Format_Identifier)
+				{
+					if(mode == LocalNames)
+						events.push_back({ScopeEvent::Local, positionAt(n+1), tokenText(n+1)});
+					else if(formatAt(n+2) == Format_Operator && tokenText(n+2).startsWith(QLatin1Char('(')))
+						events.push_back({ScopeEvent::Global, positionAt(n+1), tokenText(n+1)});
+				}
+				events.push_back({ScopeEvent::Open, position, QString()});
+				mode = FunctionName;
+				continue;
+			case Keyword_For:
+				loopNames.clear();
+				mode = LoopNames;
+				continue;
+			case Keyword_Do:
+				events.push_back({ScopeEvent::Open, position, QString()});
+				events += loopNames;
+				loopNames.clear();
+				break;
+			case Keyword_Then:
+			case Keyword_Repeat:
+				events.push_back({ScopeEvent::Open, position, QString()});
+				break;
+			case Keyword_End:
+			case Keyword_Until:
+			case Keyword_Elseif:
+				events.push_back({ScopeEvent::Close, position, QString()});
+				break;
+			case Keyword_Else:
+				events.push_back({ScopeEvent::Close, position, QString()});
+				events.push_back({ScopeEvent::Open, position, QString()});
+				break;
+			default:
+				break;
+			}
+			mode = NoDeclaration;
+			continue;
+		}
+		
+		if(format == Format_Identifier)
+		{
+			if(mode == LocalNames)
+				events.push_back({ScopeEvent::Local, position, tokenText(n)});
+			else if(mode == Parameters)
+				events.push_back({ScopeEvent::Local, position, tokenText(n)});
+			else if(mode == LoopNames)
+				loopNames.push_back({ScopeEvent::Local, position, tokenText(n)});
+			else if(mode == NoDeclaration && n == 0 && formatAt(n+1) == Format_Operator)
+			{
+				// an assignment at the start of the line, "name = value"
+				QString assignment = tokenText(n+1);
+				if(assignment.startsWith(QLatin1Char('=')) && !assignment.startsWith(QLatin1String("==")))
+					events.push_back({ScopeEvent::Global, position, tokenText(n)});
+			}
+			continue;
+		}
+		
+		if(format == Format_Operator)
+		{
+			QString op = text.mid(position, tokens.length(i));
+			if(mode == FunctionName && op.contains(QLatin1Char('(')))
+				mode = op.contains(QLatin1Char(')')) ? NoDeclaration : Parameters;
+			else if(mode == Parameters && op.contains(QLatin1Char(')')))
+				mode = NoDeclaration;
+			else if((mode == LocalNames || mode == LoopNames) && op != QLatin1String(","))
+				mode = NoDeclaration;
+			continue;
+		}
+		
+		if(mode != FunctionName && mode != Parameters)
+			mode = NoDeclaration;
+	}
+}
+
+static QStringList const g_decreaseKeywords = {
+	QStringLiteral("end"),
+	QStringLiteral("until"),
+	QStringLiteral("elseif"),
+	QStringLiteral("else")
+};
+
+LuaBlockData::LuaBlockData()
+	: m_revision(-1),
+	  m_initialState(-1),
+	  m_endState(0),
+	  m_keywordDelta(0),
+	  m_keywordMinDelta(0),
+	  m_lastKeyword(Keyword_None),
+	  m_unmatchedClosers(0),
+	  m_openScopes(0),
+	  m_unmatchedScopeClosers(0),
+	  m_declaresLocals(false),
+	  m_declaresGlobals(false),
+	  m_functionsParsed(false),
+	  m_functionsLine(0) {}
+
+bool LuaBlockData::isValidFor(QTextBlock const& block, int initialState) const
+{
+	return m_revision == block.revision() && m_initialState == initialState;
+}
+
+void LuaBlockData::scan(QString const& text, int revision, int initialState)
+{
+	Scanner::tokenize(text, initialState, m_tokens);
+	update(text, revision, initialState);
+}
+
+void LuaBlockData::assign(QString const& text, int revision, int initialState, PreScan const& preScan, int line)
+{
+	preScan.lineTokens(line, m_tokens);
+	update(text, revision, initialState);
+}
+
+void LuaBlockData::update(QString const& text, int revision, int initialState)
+{
+	m_revision = revision;
+	m_initialState = initialState;
+	m_endState = m_tokens.lineEndState(0);
+	m_identifiers.clear();
+	m_lastKeyword = Keyword_None;
+	m_keywordDelta = 0;
+	m_keywordMinDelta = 0;
+	m_openBrackets.clear();
+	m_unmatchedClosers = 0;
+	collectBrackets(text, m_tokens, text.size(), m_openBrackets, m_unmatchedClosers);
+	m_functionsParsed = false;
+	m_functions.clear();
+	m_scopeEvents.clear();
+	collectScopeEvents(text, m_tokens, m_scopeEvents);
+	m_openScopes = 0;
+	m_unmatchedScopeClosers = 0;
+	m_declaresLocals = false;
+	m_declaresGlobals = false;
+	for(ScopeEvent const& event : m_scopeEvents)
+	{
+		switch(event.m_type)
+		{
+		case ScopeEvent::Open:
+			++m_openScopes;
+			break;
+		case ScopeEvent::Close:
+			if(m_openScopes > 0)
+				--m_openScopes;
+			else
+				++m_unmatchedScopeClosers;
+			break;
+		case ScopeEvent::Local:
+			m_declaresLocals = true;
+			break;
+		case ScopeEvent::Global:
+			m_declaresGlobals = true;
+			break;
+		}
+	}
+
+	QStringList* chain = nullptr;
+	for(int i = 0; i < m_tokens.size(); ++i)
+	{
+		switch(m_tokens.format(i))
+		{
+		case Format_Keyword:
+			m_lastKeyword = m_tokens.keyword(i);
+			// Decrease first, to catch 'else'
+			if(isIndentDecreasingKeyword(m_lastKeyword))
+			{
+				--m_keywordDelta;
+				if(m_keywordDelta < m_keywordMinDelta)
+					m_keywordMinDelta = m_keywordDelta;
+			}
+			if(isIndentIncreasingKeyword(m_lastKeyword))
+				++m_keywordDelta;
+			break;
+		case Format_Identifier:
+			if(!chain)
+			{
+				m_identifiers.push_back(QStringList());
+				chain = &m_identifiers.back();
+			}
+			chain->push_back(text.mid(m_tokens.begin(i), m_tokens.length(i)));
+			break;
+		case Format_Operator:
+			if(m_tokens.length(i) != 1 || text.at(m_tokens.begin(i)) != QLatin1Char('.'))
+				chain = nullptr;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+Scanner::TokType LuaBlockData::tokenTypeAt(int offset) const
+{
+	return Scanner::tokenTypeAt(m_tokens, m_initialState, offset);
+}
+
+LuaBlockData const* LuaBlockData::get(QTextBlock const& block)
+{
+	return get(block, Scanner::StateAfterBlock(block.previous()));
+}
+
+LuaBlockData const* LuaBlockData::get(QTextBlock const& block, int initialState)
+{
+	LuaBlockData* data = attach(block);
+	if(!data->isValidFor(block, initialState))
+		data->scan(block.text(), block.revision(), initialState);
+	return data;
+}
+
+LuaBlockData* LuaBlockData::attach(QTextBlock const& block)
+{
+	TextEditor::TextBlockUserData* userData = TextEditor::TextDocumentLayout::userData(block);
+	LuaBlockData* data = dynamic_cast<LuaBlockData*>(userData->codeFormatterData());
+	if(!data)
+	{
+		data = new LuaBlockData;
+		userData->setCodeFormatterData(data);
+	}
+	return data;
+}
+
+LuaBlockData::OpenBracket LuaBlockData::openBracketAt(QTextDocument const* document, int position)
+{
+	QTextBlock block = document->findBlock(position);
+	if(!block.isValid())
+		return {-1, QChar()};
+	
+	// the block of position only counts up to position
+	QVector<OpenBracket> openBrackets;
+	int unmatchedClosers = 0;
+	collectBrackets(block.text(), get(block)->m_tokens, position - block.position(), openBrackets, unmatchedClosers);
+	if(!openBrackets.isEmpty())
+		return {block.position() + openBrackets.back().m_position, openBrackets.back().m_bracket};
+	
+	// every closing bracket still pending skips one open bracket of an earlier block
+	for(block = block.previous(); block.isValid(); block = block.previous())
+	{
+		LuaBlockData const* data = get(block);
+		if(data->m_openBrackets.size() > unmatchedClosers)
+		{
+			OpenBracket const& open = data->m_openBrackets.at(data->m_openBrackets.size() - 1 - unmatchedClosers);
+			return {block.position() + open.m_position, open.m_bracket};
+		}
+		unmatchedClosers += data->m_unmatchedClosers - data->m_openBrackets.size();
+	}
+	return {-1, QChar()};
+}
+
+QStringList LuaBlockData::visibleNames(QTextDocument const* document, int position)
+{
+	QStringList names;
+	QTextBlock block = document->findBlock(position);
+	// scopes closed between the event and position
+	int closedScopes = 0;
+	for(; block.isValid(); block = block.previous())
+	{
+		LuaBlockData const* data = get(block);
+		bool containsPosition = block.position() + block.length() > position;
+		// going back, the scopes the block leaves open are entered and its
+		// unmatched closers leave scopes; a local of it is only visible if
+		// that reaches the scope of position
+		bool declaresVisible = data->m_declaresGlobals || (data->m_declaresLocals && closedScopes <= data->m_openScopes);
+		if(!containsPosition && !declaresVisible)
+		{
+			closedScopes = qMax(closedScopes - data->m_openScopes, 0) + data->m_unmatchedScopeClosers;
+			continue;
+		}
+		
+		QVector<ScopeEvent> const& events = data->m_scopeEvents;
+		int end = containsPosition ? position - block.position() : block.length();
+		for(int i = events.size() - 1; i >= 0; --i)
+		{
+			ScopeEvent const& event = events.at(i);
+			if(event.m_position >= end)
+				continue;
+			
+			switch(event.m_type)
+			{
+			case ScopeEvent::Close:
+				++closedScopes;
+				break;
+			case ScopeEvent::Open:
+				// leaving a closed scope, or entering one that encloses position
+				if(closedScopes > 0)
+					--closedScopes;
+				break;
+			case ScopeEvent::Local:
+				if(closedScopes == 0)
+					names.push_back(event.m_name);
+				break;
+			case ScopeEvent::Global:
+				names.push_back(event.m_name);
+				break;
+			}
+		}
+	}
+	return names;
+}
+
+bool LuaBlockData::isIndentIncreasingKeyword(Keyword keyword)
+{
+	switch(keyword)
+	{
+	case Keyword_Function:
+	case Keyword_Do:
+	case Keyword_Then:
+	case Keyword_Else:
+	case Keyword_Repeat:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool LuaBlockData::isIndentDecreasingKeyword(Keyword keyword)
+{
+	switch(keyword)
+	{
+	case Keyword_End:
+	case Keyword_Until:
+	case Keyword_Elseif:
+	case Keyword_Else:
+		return true;
+	default:
+		return false;
+	}
+}
+
+QStringList const& LuaBlockData::indentDecreasingKeywords()
+{
+	return g_decreaseKeywords;
+}
+
+} }
@@ -0,0 +1,132 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUABLOCKDATA_H
+#define LUABLOCKDATA_H
+#include "../luaeditor_global.h"
+#include "../luafunctionparser.h"
+#include "luaformattoken.h"
+#include "luascanner.h"
+#include "luatokenbuffer.h"
+#include <texteditor/textdocumentlayout.h>
+#include <QStringList>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QVector>
+
+namespace LuaEditor { namespace Internal {
+
+// Result of scanning one block, attached to the block's TextBlockUserData so
+// that the highlighter, indenter, autocompleter and completion processor share
+// a single scan per edit. The data is only valid for the block revision and
+// the scanner state it was built with, see isValidFor().
+class PreScan;
+
+class LuaBlockData : public TextEditor::CodeFormatterData
+{
+public:
+	struct OpenBracket
+	{
+		// in the block, or in the document for openBracketAt()
+		int m_position;
+		QChar m_bracket;
+	};
+	
+	// a scope boundary or a declared name, in the order of the block
+	struct ScopeEvent
+	{
+		enum Type
+		{
+			Open,
+			Close,
+			// visible until the end of the enclosing scope
+			Local,
+			// visible everywhere after it
+			Global
+		};
+		
+		Type m_type;
+		int m_position;
+		QString m_name;
+	};
+	
+	LuaBlockData();
+
+	bool isValidFor(QTextBlock const& block, int initialState) const;
+	void scan(QString const& text, int revision, int initialState);
+	// takes the tokens of line from preScan instead of scanning text
+	void assign(QString const& text, int revision, int initialState, PreScan const& preScan, int line);
+	Scanner::TokType tokenTypeAt(int offset) const;
+
+	// returns the data of block, scanning it first if the cached data is stale
+	static LuaBlockData const* get(QTextBlock const& block);
+	static LuaBlockData const* get(QTextBlock const& block, int initialState);
+	// returns the data attached to block, creating an empty one if necessary
+	static LuaBlockData* attach(QTextBlock const& block);
+
+	// the innermost bracket still open before position, brackets in strings
+	// and comments don't count; m_position is -1 if there is none. Only the
+	// blocks back to that bracket are looked at, each in constant time.
+	static OpenBracket openBracketAt(QTextDocument const* document, int position);
+	// names declared before position that are visible there, nearest first;
+	// locals of scopes closed before position are left out. The events of a
+	// block are only looked at if one of its names can be visible.
+	static QStringList visibleNames(QTextDocument const* document, int position);
+	
+	static bool isIndentIncreasingKeyword(Keyword keyword);
+	static bool isIndentDecreasingKeyword(Keyword keyword);
+	static QStringList const& indentDecreasingKeywords();
+
+	int m_revision;
+	int m_initialState;
+	int m_endState;
+
+	TokenBuffer m_tokens;
+
+	// see LuaIndenter::getLineDelta
+	int m_keywordDelta;
+	int m_keywordMinDelta;
+	Keyword m_lastKeyword;
+
+	// chains of identifiers joined by '.', e.g. {"a","b","c"} for "a.b.c"
+	QVector<QStringList> m_identifiers;
+	
+	// '(', '[' and '{' not closed within the block, and the number of
+	// closing brackets at its beginning that close brackets of earlier blocks
+	QVector<OpenBracket> m_openBrackets;
+	int m_unmatchedClosers;
+	
+	// blocks of function, do, then and repeat, local declarations,
+	// parameters, loop variables and assignments to global names
+	QVector<ScopeEvent> m_scopeEvents;
+	// like m_openBrackets and m_unmatchedClosers for the scopes of
+	// m_scopeEvents, so that visibleNames() can step over a block
+	int m_openScopes;
+	int m_unmatchedScopeClosers;
+	bool m_declaresLocals;
+	bool m_declaresGlobals;
+	
+	// the functions declared in the block, parsed by DocumentSymbols the
+	// first time they're needed after a scan, with lines for the block
+	// number m_functionsLine
+	bool m_functionsParsed;
+	int m_functionsLine;
+	FunctionParser::FunctionList m_functions;
+
+private:
+	void update(QString const& text, int revision, int initialState);
+};
+
+} }
+#endif // LUABLOCKDATA_H
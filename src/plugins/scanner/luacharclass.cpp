@@ -0,0 +1,30 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luacharclass.h"
+
+namespace LuaEditor { namespace Internal {
+
+#define LUA_CHARCLASS4(ch) classify(ch), classify(ch+1), classify(ch+2), classify(ch+3)
+#define LUA_CHARCLASS16(ch) LUA_CHARCLASS4(ch), LUA_CHARCLASS4(ch+4), LUA_CHARCLASS4(ch+8), LUA_CHARCLASS4(ch+12)
+
+const unsigned char CharClass::s_ascii[128] = {
+	LUA_CHARCLASS16(0x00), LUA_CHARCLASS16(0x10), LUA_CHARCLASS16(0x20), LUA_CHARCLASS16(0x30),
+	LUA_CHARCLASS16(0x40), LUA_CHARCLASS16(0x50), LUA_CHARCLASS16(0x60), LUA_CHARCLASS16(0x70)
+};
+
+#undef LUA_CHARCLASS16
+#undef LUA_CHARCLASS4
+
+} }
@@ -0,0 +1,87 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUACHARCLASS_H
+#define LUACHARCLASS_H
+#include "../luaeditor_global.h"
+#include <QChar>
+
+namespace LuaEditor { namespace Internal {
+
+// Character classification used by the scanner. Code units below 128 are
+// looked up in a table, everything else falls back to the Unicode
+// properties QChar provides, so the results match QChar::isLetter() etc.
+// For UTF-8 code units, all bytes of multi-byte sequences are treated as
+// letters, so identifiers containing non-ASCII letters stay in one piece.
+class CharClass
+{
+public:
+	enum Flag {
+		Letter			=0x01,
+		Digit			=0x02,
+		HexDigit		=0x04,
+		Space			=0x08,
+		Punct			=0x10,
+		Underscore		=0x20,
+		// punctuation readOperator() consumes, i.e. without quotes and '_'
+		Operator		=0x40
+	};
+
+	static inline bool isLetter(QChar ch) { return test(ch, Letter) || (!isAscii(ch) && ch.isLetter()); }
+	static inline bool isDigit(QChar ch) { return test(ch, Digit) || (!isAscii(ch) && ch.isDigit()); }
+	static inline bool isHexDigit(QChar ch) { return test(ch, HexDigit) || (!isAscii(ch) && ch.isDigit()); }
+	static inline bool isSpace(QChar ch) { return test(ch, Space) || (!isAscii(ch) && ch.isSpace()); }
+	static inline bool isIdentifierStart(QChar ch) { return test(ch, Letter|Underscore) || (!isAscii(ch) && ch.isLetter()); }
+	static inline bool isIdentifierChar(QChar ch) { return test(ch, Letter|Digit|Underscore) || (!isAscii(ch) && ch.isLetterOrNumber()); }
+	static inline bool isOperator(QChar ch) { return test(ch, Operator) || (!isAscii(ch) && ch.isPunct()); }
+
+	static inline bool isLetter(char ch) { return test(ch, Letter) || !isAscii(ch); }
+	static inline bool isDigit(char ch) { return test(ch, Digit); }
+	static inline bool isHexDigit(char ch) { return test(ch, HexDigit); }
+	static inline bool isSpace(char ch) { return test(ch, Space); }
+	static inline bool isIdentifierStart(char ch) { return test(ch, Letter|Underscore) || !isAscii(ch); }
+	static inline bool isIdentifierChar(char ch) { return test(ch, Letter|Digit|Underscore) || !isAscii(ch); }
+	static inline bool isOperator(char ch) { return test(ch, Operator); }
+
+private:
+	static inline bool isAscii(QChar ch) { return ch.unicode() < 128; }
+	static inline bool test(QChar ch, int flags) { return isAscii(ch) && (s_ascii[ch.unicode()] & flags); }
+	static inline bool isAscii(char ch) { return static_cast<uchar>(ch) < 128; }
+	static inline bool test(char ch, int flags) { return isAscii(ch) && (s_ascii[static_cast<uchar>(ch)] & flags); }
+
+	static constexpr unsigned char classify(int ch)
+	{
+		return ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ? Letter : 0)
+			| (ch >= '0' && ch <= '9' ? Digit|HexDigit : 0)
+			| ((ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F') ? HexDigit : 0)
+			| (ch == ' ' || (ch >= '\t' && ch <= '\r') ? Space : 0)
+			| (isPunctuation(ch) ? Punct : 0)
+			| (ch == '_' ? Underscore : 0)
+			| (isPunctuation(ch) && ch != '"' && ch != '\'' && ch != '_' ? Operator : 0);
+	}
+	// the ASCII characters of the Unicode punctuation categories (QChar::isPunct);
+	// $ + < = > ^ ` | ~ are symbols
+	static constexpr bool isPunctuation(int ch)
+	{
+		return ch == '!' || ch == '"' || ch == '#' || ch == '%' || ch == '&' || ch == '\''
+			|| ch == '(' || ch == ')' || ch == '*' || ch == ',' || ch == '-' || ch == '.'
+			|| ch == '/' || ch == ':' || ch == ';' || ch == '?' || ch == '@' || ch == '['
+			|| ch == '\\' || ch == ']' || ch == '_' || ch == '{' || ch == '}';
+	}
+
+	static const unsigned char s_ascii[128];
+};
+
+} }
+#endif // LUACHARCLASS_H
@@ -37,16 +37,78 @@ enum Format {
 	Format_EndOfBlock
 };
 
+// identifiers with a special meaning, see classifyIdentifier in luascanner.cpp
+enum Keyword {
+	Keyword_None =0,
+	
+	// Format_Keyword
+	Keyword_And,
+	Keyword_Break,
+	Keyword_Do,
+	Keyword_Else,
+	Keyword_Elseif,
+	Keyword_End,
+	Keyword_False,
+	Keyword_For,
+	Keyword_Function,
+	Keyword_Goto,
+	Keyword_If,
+	Keyword_In,
+	Keyword_Nil,
+	Keyword_Not,
+	Keyword_Or,
+	Keyword_Repeat,
+	Keyword_Return,
+	Keyword_Then,
+	Keyword_True,
+	Keyword_Until,
+	Keyword_While,
+	
+	// Format_Local
+	Keyword_Local,
+	
+	// Format_ClassField
+	Keyword_Self,
+	
+	// Format_MagicAttr
+	Keyword_MagicAdd,
+	Keyword_MagicSub,
+	Keyword_MagicMul,
+	Keyword_MagicDiv,
+	Keyword_MagicMod,
+	Keyword_MagicPow,
+	Keyword_MagicUnm,
+	Keyword_MagicIdiv,
+	Keyword_MagicBand,
+	Keyword_MagicBor,
+	Keyword_MagicBxor,
+	Keyword_MagicBnot,
+	Keyword_MagicShl,
+	Keyword_MagicShr,
+	Keyword_MagicConcat,
+	Keyword_MagicLen,
+	Keyword_MagicEq,
+	Keyword_MagicLt,
+	Keyword_MagicLe,
+	Keyword_MagicIndex,
+	Keyword_MagicNewindex,
+	Keyword_MagicCall,
+	
+	Keyword_KeywordsAmount
+};
+
 struct FormatToken {
-	FormatToken(Format format = Format_FormatsAmount, size_t position =0, size_t length =0)
-		: m_format(format), m_position(position), m_length(length) {}
+	FormatToken(Format format = Format_FormatsAmount, size_t position =0, size_t length =0, Keyword keyword = Keyword_None)
+		: m_format(format), m_keyword(keyword), m_position(position), m_length(length) {}
 	
 	inline Format format() const { return m_format; }
+	inline Keyword keyword() const { return m_keyword; }
 	inline size_t begin() const { return m_position; }
 	inline size_t end() const { return m_position+m_length; }
 	inline size_t length() const { return m_length; }
 private:
 	Format m_format;
+	Keyword m_keyword;
 	size_t m_position;
 	size_t m_length;
 };
@@ -0,0 +1,176 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luaprescan.h"
+#include "luascanner.h"
+#include <utils/runextensions.h>
+#include <QFuture>
+#include <QThreadPool>
+#include <algorithm>
+
+enum {
+	// chunks per thread, so that threads finishing early can take another one
+	PRESCAN_CHUNKS_PER_THREAD = 4,
+	// chunks aren't made smaller than this many characters
+	PRESCAN_MIN_CHUNK_LENGTH = 64 * 1024
+};
+
+namespace LuaEditor { namespace Internal {
+
+// the jobs wait for each other, so they don't go to the global pool
+static QThreadPool* chunkPool()
+{
+	static QThreadPool pool;
+	return &pool;
+}
+
+QSharedPointer<PreScan> PreScan::create(QString const& text, int threadCount)
+{
+	QSharedPointer<PreScan> result(new PreScan);
+	result->m_chunks = split(text, qMax(threadCount, 1) * PRESCAN_CHUNKS_PER_THREAD);
+	
+	QThreadPool* pool = chunkPool();
+	pool->setMaxThreadCount(qMax(threadCount - 1, 1));
+	
+	QVector<Chunk>& chunks = result->m_chunks;
+	QList<QFuture<void>> futures;
+	for(int i = 1; i < chunks.size(); ++i)
+	{
+		Chunk* chunk = &chunks[i];
+		futures.append(Utils::runAsync(pool, [&text, chunk]() { scanChunk(text, *chunk); }));
+	}
+	scanChunk(text, chunks[0]);
+	for(QFuture<void>& future : futures)
+		future.waitForFinished();
+	
+	fixupChunks(text, chunks);
+	return result;
+}
+
+QSharedPointer<PreScan> PreScan::createFromLines(QStringList const& lines, int threadCount)
+{
+	return create(lines.join(QLatin1Char('\n')), threadCount);
+}
+
+QVector<PreScan::Chunk> PreScan::split(QString const& text, int chunkCount)
+{
+	int targetLength = qMax(text.size() / qMax(chunkCount, 1), static_cast<int>(PRESCAN_MIN_CHUNK_LENGTH));
+	ushort const* units = reinterpret_cast<ushort const*>(text.constData());
+	
+	QVector<Chunk> chunks;
+	int offset = 0;
+	for(;;)
+	{
+		int end = text.size();
+		if(text.size() - offset > targetLength)
+			end = ScanKernels::findFirstOf(units, offset + targetLength, text.size(), '\n', '\n', '\n');
+		
+		Chunk chunk;
+		chunk.m_offset = offset;
+		chunk.m_length = end - offset;
+		chunks.append(chunk);
+		
+		if(end >= text.size())
+			break;
+		offset = end + 1;
+	}
+	return chunks;
+}
+
+void PreScan::scanChunk(QString const& text, Chunk& chunk)
+{
+	chunk.m_initialState = 0;
+	Scanner::tokenize(text.constData() + chunk.m_offset, chunk.m_length, chunk.m_initialState, chunk.m_tokens);
+}
+
+void PreScan::fixupChunk(QString const& text, Chunk& chunk, int initialState)
+{
+	if(initialState == chunk.m_initialState)
+		return;
+	
+	QChar const* begin = text.constData() + chunk.m_offset;
+	TokenBuffer const& speculative = chunk.m_tokens;
+	int lineCount = speculative.lineCount();
+	
+	// once a line ends in the same state as before, the following lines are right
+	int state = initialState;
+	int line = 0;
+	for(; line < lineCount; ++line)
+	{
+		int lineBegin = speculative.lineOffset(line);
+		int lineEnd = line+1 < lineCount ? speculative.lineOffset(line+1) - 1 : chunk.m_length;
+		
+		Scanner scanner(begin + lineBegin, lineEnd - lineBegin);
+		scanner.setState(state);
+		FormatToken tk;
+		while((tk = scanner.read()).format() != Format_EndOfBlock && tk.length() != 0) {}
+		state = scanner.state();
+		
+		if(state == speculative.lineEndState(line))
+			break;
+	}
+	
+	int fixedLength = line+1 < lineCount ? speculative.lineOffset(line+1) - 1 : chunk.m_length;
+	TokenBuffer fixed;
+	Scanner::tokenize(begin, fixedLength, initialState, fixed);
+	fixed.appendLines(speculative, line+1);
+	
+	std::swap(chunk.m_tokens, fixed);
+	chunk.m_initialState = initialState;
+}
+
+void PreScan::fixupChunks(QString const& text, QVector<Chunk>& chunks)
+{
+	int state = 0;
+	int line = 0;
+	for(Chunk& chunk : chunks)
+	{
+		fixupChunk(text, chunk, state);
+		chunk.m_firstLine = line;
+		line += chunk.m_tokens.lineCount();
+		state = chunk.m_tokens.lineEndState(chunk.m_tokens.lineCount()-1);
+	}
+}
+
+int PreScan::lineCount() const
+{
+	Chunk const& last = m_chunks.last();
+	return last.m_firstLine + last.m_tokens.lineCount();
+}
+
+int PreScan::lineInitialState(int line) const
+{
+	return line == 0 ? 0 : lineEndState(line-1);
+}
+
+int PreScan::lineEndState(int line) const
+{
+	Chunk const& chunk = chunkAt(line);
+	return chunk.m_tokens.lineEndState(line - chunk.m_firstLine);
+}
+
+void PreScan::lineTokens(int line, TokenBuffer& target) const
+{
+	Chunk const& chunk = chunkAt(line);
+	target.assignLine(chunk.m_tokens, line - chunk.m_firstLine);
+}
+
+PreScan::Chunk const& PreScan::chunkAt(int line) const
+{
+	auto it = std::upper_bound(m_chunks.constBegin(), m_chunks.constEnd(), line,
+							   [](int l, Chunk const& chunk) { return l < chunk.m_firstLine; });
+	return *(it - 1);
+}
+
+} }
@@ -0,0 +1,73 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUAPRESCAN_H
+#define LUAPRESCAN_H
+#include "../luaeditor_global.h"
+#include "luatokenbuffer.h"
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace LuaEditor { namespace Internal {
+
+// Tokens and line states of a whole document, scanned in parallel before the
+// highlighter gets to it. The scanner state is a plain int, so the text is
+// split into chunks that are scanned concurrently, each assuming it starts in
+// State_Default. Chunks starting inside a long string or comment are fixed up
+// afterwards, re-scanning lines until their end state agrees with the
+// speculative one.
+class PreScan
+{
+public:
+	struct Chunk {
+		Chunk() : m_firstLine(0), m_offset(0), m_length(0), m_initialState(0) {}
+		
+		int m_firstLine;
+		// position of the chunk in the text, token offsets are relative to it
+		int m_offset;
+		int m_length;
+		int m_initialState;
+		TokenBuffer m_tokens;
+	};
+	
+	// scans text with threadCount threads, call it from a worker thread
+	static QSharedPointer<PreScan> create(QString const& text, int threadCount);
+	// like create(), for the text of lines joined by line feeds
+	static QSharedPointer<PreScan> createFromLines(QStringList const& lines, int threadCount);
+	
+	// splits text at line breaks into about chunkCount chunks
+	static QVector<Chunk> split(QString const& text, int chunkCount);
+	// scans chunk assuming State_Default
+	static void scanChunk(QString const& text, Chunk& chunk);
+	// re-scans the beginning of chunk for its real initial state
+	static void fixupChunk(QString const& text, Chunk& chunk, int initialState);
+	// fixes up all chunks in order and numbers their lines
+	static void fixupChunks(QString const& text, QVector<Chunk>& chunks);
+	
+	int lineCount() const;
+	int lineInitialState(int line) const;
+	int lineEndState(int line) const;
+	// replaces target with the tokens of line, at offsets relative to the line
+	void lineTokens(int line, TokenBuffer& target) const;
+	
+private:
+	Chunk const& chunkAt(int line) const;
+	
+	QVector<Chunk> m_chunks;
+};
+
+} }
+#endif // LUAPRESCAN_H
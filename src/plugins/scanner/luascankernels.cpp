@@ -0,0 +1,194 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luascankernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LUAEDITOR_SCAN_SSE2
+	#include <emmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
+#if defined(LUAEDITOR_SCAN_SSE2) && (defined(__GNUC__) || defined(__clang__))
+	#define LUAEDITOR_SCAN_AVX2
+	#include <immintrin.h>
+#endif
+
+namespace LuaEditor { namespace Internal {
+
+int ScanKernels::findFirstOfScalar(ushort const* text, int from, int length, ushort a, ushort b, ushort c)
+{
+	for(int i = from; i < length; ++i)
+	{
+		ushort ch = text[i];
+		if(ch == a || ch == b || ch == c)
+			return i;
+	}
+	return length;
+}
+
+int ScanKernels::findFirstOfScalar(char const* text, int from, int length, char a, char b, char c)
+{
+	for(int i = from; i < length; ++i)
+	{
+		char ch = text[i];
+		if(ch == a || ch == b || ch == c)
+			return i;
+	}
+	return length;
+}
+
+#ifdef LUAEDITOR_SCAN_SSE2
+static inline int lowestBit(unsigned int mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static int findFirstOfSse2(ushort const* text, int from, int length, ushort a, ushort b, ushort c)
+{
+	__m128i const va = _mm_set1_epi16(static_cast<short>(a));
+	__m128i const vb = _mm_set1_epi16(static_cast<short>(b));
+	__m128i const vc = _mm_set1_epi16(static_cast<short>(c));
+
+	int i = from;
+	for(; i + 8 <= length; i += 8)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(text + i));
+		__m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(v, va), _mm_cmpeq_epi16(v, vb)), _mm_cmpeq_epi16(v, vc));
+		unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(hit));
+		if(mask)
+			return i + lowestBit(mask) / 2;
+	}
+	return ScanKernels::findFirstOfScalar(text, i, length, a, b, c);
+}
+
+static int findFirstOfSse2(char const* text, int from, int length, char a, char b, char c)
+{
+	__m128i const va = _mm_set1_epi8(a);
+	__m128i const vb = _mm_set1_epi8(b);
+	__m128i const vc = _mm_set1_epi8(c);
+
+	int i = from;
+	for(; i + 16 <= length; i += 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(text + i));
+		__m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)), _mm_cmpeq_epi8(v, vc));
+		unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(hit));
+		if(mask)
+			return i + lowestBit(mask);
+	}
+	return ScanKernels::findFirstOfScalar(text, i, length, a, b, c);
+}
+#endif
+
+#ifdef LUAEDITOR_SCAN_AVX2
+__attribute__((target("avx2")))
+static int findFirstOfAvx2(ushort const* text, int from, int length, ushort a, ushort b, ushort c)
+{
+	__m256i const va = _mm256_set1_epi16(static_cast<short>(a));
+	__m256i const vb = _mm256_set1_epi16(static_cast<short>(b));
+	__m256i const vc = _mm256_set1_epi16(static_cast<short>(c));
+
+	int i = from;
+	for(; i + 16 <= length; i += 16)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(text + i));
+		__m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(v, va), _mm256_cmpeq_epi16(v, vb)), _mm256_cmpeq_epi16(v, vc));
+		unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(hit));
+		if(mask)
+			return i + lowestBit(mask) / 2;
+	}
+	return findFirstOfSse2(text, i, length, a, b, c);
+}
+
+__attribute__((target("avx2")))
+static int findFirstOfAvx2(char const* text, int from, int length, char a, char b, char c)
+{
+	__m256i const va = _mm256_set1_epi8(a);
+	__m256i const vb = _mm256_set1_epi8(b);
+	__m256i const vc = _mm256_set1_epi8(c);
+
+	int i = from;
+	for(; i + 32 <= length; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(text + i));
+		__m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)), _mm256_cmpeq_epi8(v, vc));
+		unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(hit));
+		if(mask)
+			return i + lowestBit(mask);
+	}
+	return findFirstOfSse2(text, i, length, a, b, c);
+}
+#endif
+
+typedef int (*FindFirstOfKernel)(ushort const*, int, int, ushort, ushort, ushort);
+typedef int (*FindFirstOfByteKernel)(char const*, int, int, char, char, char);
+
+static bool hasAvx2()
+{
+#ifdef LUAEDITOR_SCAN_AVX2
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+static FindFirstOfKernel selectFindFirstOf()
+{
+#ifdef LUAEDITOR_SCAN_AVX2
+	if(hasAvx2())
+		return &findFirstOfAvx2;
+#endif
+#ifdef LUAEDITOR_SCAN_SSE2
+	return &findFirstOfSse2;
+#else
+	return &ScanKernels::findFirstOfScalar;
+#endif
+}
+
+static FindFirstOfByteKernel selectFindFirstOfByte()
+{
+#ifdef LUAEDITOR_SCAN_AVX2
+	if(hasAvx2())
+		return &findFirstOfAvx2;
+#endif
+#ifdef LUAEDITOR_SCAN_SSE2
+	return &findFirstOfSse2;
+#else
+	return &ScanKernels::findFirstOfScalar;
+#endif
+}
+
+int ScanKernels::findFirstOf(ushort const* text, int from, int length, ushort a, ushort b, ushort c)
+{
+	static FindFirstOfKernel const kernel = selectFindFirstOf();
+	return kernel(text, from, length, a, b, c);
+}
+
+int ScanKernels::findFirstOf(char const* text, int from, int length, char a, char b, char c)
+{
+	static FindFirstOfByteKernel const kernel = selectFindFirstOfByte();
+	return kernel(text, from, length, a, b, c);
+}
+
+} }
@@ -0,0 +1,38 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUASCANKERNELS_H
+#define LUASCANKERNELS_H
+#include "../luaeditor_global.h"
+
+namespace LuaEditor { namespace Internal {
+
+// Search kernels for the scanner's long runs, i.e. comment and string bodies.
+// The vectorized variants compare 16 (SSE2) or 32 (AVX2) bytes at once, that
+// is 8 or 16 UTF-16 code units; AVX2 is picked at runtime if the CPU supports it.
+class ScanKernels
+{
+public:
+	// index of the first code unit in [from, length) equal to a, b or c,
+	// length if there is none
+	static int findFirstOf(ushort const* text, int from, int length, ushort a, ushort b, ushort c);
+
+	static int findFirstOf(char const* text, int from, int length, char a, char b, char c);
+
+	static int findFirstOfScalar(ushort const* text, int from, int length, ushort a, ushort b, ushort c);
+	static int findFirstOfScalar(char const* text, int from, int length, char a, char b, char c);
+};
+
+} }
+#endif // LUASCANKERNELS_H
@@ -13,194 +13,189 @@
 */
 
 #include "luascanner.h"
+#include "luablockdata.h"
+#include "luacharclass.h"
 
 namespace LuaEditor { namespace Internal {
 
-static QMap<Format,QSet<QString>> const g_pairs =
-{
-	{Format_ClassField, {
-		QStringLiteral("self")
-	}},
-	{Format_Local, {
-		QStringLiteral("local")
-	}},
-	{Format_MagicAttr, {
-		QStringLiteral("__add"),
-		QStringLiteral("__sub"),
-		QStringLiteral("__mul"),
-		QStringLiteral("__div"),
-		QStringLiteral("__mod"),
-		QStringLiteral("__pow"),
-		QStringLiteral("__unm"),
-		QStringLiteral("__idiv"),
-		QStringLiteral("__band"),
-		QStringLiteral("__bor"),
-		QStringLiteral("__bxor"),
-		QStringLiteral("__bnot"),
-		QStringLiteral("__shl"),
-		QStringLiteral("__shr"),
-		QStringLiteral("__concat"),
-		QStringLiteral("__len"),
-		QStringLiteral("__eq"),
-		QStringLiteral("__lt"),
-		QStringLiteral("__le"),
-		QStringLiteral("__index"),
-		QStringLiteral("__newindex"),
-		QStringLiteral("__call")
-	}},
-	{Format_Keyword, {
-		QStringLiteral("and"),
-		QStringLiteral("break"),
-		QStringLiteral("do"),
-		QStringLiteral("else"),
-		QStringLiteral("elseif"),
-		QStringLiteral("end"),
-		QStringLiteral("false"),
-		QStringLiteral("for"),
-		QStringLiteral("function"),
-		QStringLiteral("goto"),
-		QStringLiteral("if"),
-		QStringLiteral("in"),
-		QStringLiteral("local"),
-		QStringLiteral("nil"),
-		QStringLiteral("not"),
-		QStringLiteral("or"),
-		QStringLiteral("repeat"),
-		QStringLiteral("return"),
-		QStringLiteral("then"),
-		QStringLiteral("true"),
-		QStringLiteral("until"),
-		QStringLiteral("while")
-	}}
+struct KeywordEntry {
+	char const* m_name;
+	Keyword m_keyword;
+	Format m_format;
+};
+
+// keywords grouped by length, so an identifier is compared against a handful
+// of candidates at most and never has to be copied into a QString
+static constexpr KeywordEntry g_keywords2[] = {
+	{"do", Keyword_Do, Format_Keyword},
+	{"if", Keyword_If, Format_Keyword},
+	{"in", Keyword_In, Format_Keyword},
+	{"or", Keyword_Or, Format_Keyword}
+};
+static constexpr KeywordEntry g_keywords3[] = {
+	{"and", Keyword_And, Format_Keyword},
+	{"end", Keyword_End, Format_Keyword},
+	{"for", Keyword_For, Format_Keyword},
+	{"nil", Keyword_Nil, Format_Keyword},
+	{"not", Keyword_Not, Format_Keyword}
+};
+static constexpr KeywordEntry g_keywords4[] = {
+	{"else", Keyword_Else, Format_Keyword},
+	{"goto", Keyword_Goto, Format_Keyword},
+	{"then", Keyword_Then, Format_Keyword},
+	{"true", Keyword_True, Format_Keyword},
+	{"self", Keyword_Self, Format_ClassField},
+	{"__eq", Keyword_MagicEq, Format_MagicAttr},
+	{"__lt", Keyword_MagicLt, Format_MagicAttr},
+	{"__le", Keyword_MagicLe, Format_MagicAttr}
+};
+static constexpr KeywordEntry g_keywords5[] = {
+	{"break", Keyword_Break, Format_Keyword},
+	{"false", Keyword_False, Format_Keyword},
+	{"until", Keyword_Until, Format_Keyword},
+	{"while", Keyword_While, Format_Keyword},
+	{"local", Keyword_Local, Format_Local},
+	{"__add", Keyword_MagicAdd, Format_MagicAttr},
+	{"__sub", Keyword_MagicSub, Format_MagicAttr},
+	{"__mul", Keyword_MagicMul, Format_MagicAttr},
+	{"__div", Keyword_MagicDiv, Format_MagicAttr},
+	{"__mod", Keyword_MagicMod, Format_MagicAttr},
+	{"__pow", Keyword_MagicPow, Format_MagicAttr},
+	{"__unm", Keyword_MagicUnm, Format_MagicAttr},
+	{"__bor", Keyword_MagicBor, Format_MagicAttr},
+	{"__shl", Keyword_MagicShl, Format_MagicAttr},
+	{"__shr", Keyword_MagicShr, Format_MagicAttr},
+	{"__len", Keyword_MagicLen, Format_MagicAttr}
+};
+static constexpr KeywordEntry g_keywords6[] = {
+	{"elseif", Keyword_Elseif, Format_Keyword},
+	{"repeat", Keyword_Repeat, Format_Keyword},
+	{"return", Keyword_Return, Format_Keyword},
+	{"__idiv", Keyword_MagicIdiv, Format_MagicAttr},
+	{"__band", Keyword_MagicBand, Format_MagicAttr},
+	{"__bxor", Keyword_MagicBxor, Format_MagicAttr},
+	{"__bnot", Keyword_MagicBnot, Format_MagicAttr},
+	{"__call", Keyword_MagicCall, Format_MagicAttr}
+};
+static constexpr KeywordEntry g_keywords7[] = {
+	{"__index", Keyword_MagicIndex, Format_MagicAttr}
+};
+static constexpr KeywordEntry g_keywords8[] = {
+	{"function", Keyword_Function, Format_Keyword},
+	{"__concat", Keyword_MagicConcat, Format_MagicAttr}
 };
+static constexpr KeywordEntry g_keywords10[] = {
+	{"__newindex", Keyword_MagicNewindex, Format_MagicAttr}
+};
+
+template<int N, typename Char>
+static Format findKeyword(KeywordEntry const (&entries)[N], Char const* text, int length, Keyword& keyword)
+{
+	for(KeywordEntry const& entry : entries)
+	{
+		int i = 0;
+		while(i < length && CodeUnit<Char>::value(text[i]) == static_cast<uchar>(entry.m_name[i]))
+			++i;
+		if(i == length)
+		{
+			keyword = entry.m_keyword;
+			return entry.m_format;
+		}
+	}
+	keyword = Keyword_None;
+	return Format_Identifier;
+}
 
-Scanner::Scanner(QChar const* text, int const length)
+template<typename Char>
+static Format classifyIdentifier(Char const* text, int length, Keyword& keyword)
+{
+	switch(length)
+	{
+	case 2: return findKeyword(g_keywords2, text, length, keyword);
+	case 3: return findKeyword(g_keywords3, text, length, keyword);
+	case 4: return findKeyword(g_keywords4, text, length, keyword);
+	case 5: return findKeyword(g_keywords5, text, length, keyword);
+	case 6: return findKeyword(g_keywords6, text, length, keyword);
+	case 7: return findKeyword(g_keywords7, text, length, keyword);
+	case 8: return findKeyword(g_keywords8, text, length, keyword);
+	case 10: return findKeyword(g_keywords10, text, length, keyword);
+	default:
+		keyword = Keyword_None;
+		return Format_Identifier;
+	}
+}
+
+template<typename Char>
+BasicScanner<Char>::BasicScanner(Char const* text, int const length)
 	: m_src(text, length),
 	  m_state(0) {}
 
-void Scanner::setState(int state) { m_state = state; }
-int Scanner::state() const { return m_state; }
+template<typename Char>
+void BasicScanner<Char>::setState(int state) { m_state = state; }
+template<typename Char>
+int BasicScanner<Char>::state() const { return m_state; }
 
-FormatToken Scanner::read()
+template<typename Char>
+FormatToken BasicScanner<Char>::read()
 {
 	m_src.setAnchor();
 	if(m_src.isEnd())
 		return FormatToken(Format_EndOfBlock, m_src.anchor(), 0);
 	
 	State state;
-	QChar saved;
+	ushort saved;
 	parseState(state, saved);
 	switch(state) {
 	case State_String:
-		return readStringLiteral(saved);
+		return readStringLiteral(CodeUnit<Char>::fromValue(saved));
 	case State_MultiLineString:
-		return readMultiLineStringLiteral(static_cast<int>(saved.toLatin1()));
+		return readMultiLineStringLiteral(static_cast<int>(saved));
 	case State_MultiLineComment:
-		return readMultiLineComment(static_cast<int>(saved.toLatin1()));
+		return readMultiLineComment(static_cast<int>(saved));
 	default:
 		return onDefaultState();
 	}
 }
 
-QString Scanner::value(FormatToken const& tk) const
+template<typename Char>
+QString BasicScanner<Char>::value(FormatToken const& tk) const
 {
 	return m_src.value(tk.begin(), tk.length());
 }
 
-Scanner::TokType Scanner::tokenTypeAt(int offset)
+template<typename Char>
+FormatToken BasicScanner<Char>::onDefaultState()
 {
-	SourceCodeStream old_src = m_src;
-	int old_state = m_state;
-	FormatToken result;
-	TokType type = TT_Code;
-	
-	{
-		m_src.anchorTo(0);
-		
-		result = read();
-		if(result.format() != Format_EndOfBlock)
-		{
-			FormatToken lastValidToken = result;
-			do {
-				lastValidToken = result;
-				if(offset >= static_cast<int>(result.begin()) )
-					break;
-			} while((result = read()).format() != Format_EndOfBlock);
-			if(lastValidToken.format() == Format_Comment)
-				type = TT_Comment;
-			else if(static_cast<int>(lastValidToken.end()) > offset)
-			{
-				switch(lastValidToken.format())
-				{
-				case Format_MLComment:
-					type = TT_Comment;
-					break;
-				case Format_String:
-					type = TT_String;
-					break;
-				default:
-					break;
-				}
-			}
-		}
-		else
-		{
-			QChar ch;
-			State s;
-			this->parseState(s,ch);
-			switch(s)
-			{
-			case State_String:
-			case State_MultiLineString:
-				type = TT_String;
-				break;
-			case State_MultiLineComment:
-				type = TT_Comment;
-				break;
-			default:
-				break;
-			}
-		}
-	}
-	
-	old_src = m_src;
-	m_state = old_state;
-	
-	return type;
-}
-
-FormatToken Scanner::onDefaultState()
-{
-	QChar first = m_src.peek();
+	Char first = m_src.peek();
 	m_src.move();
 	
-	if(first == QLatin1Char('\\') && m_src.peek() == QLatin1Char('\n'))
+	if(first == Latin1('\\') && m_src.peek() == Latin1('\n'))
 	{
 		m_src.move();
 		return FormatToken(Format_Whitespace, m_src.anchor(), 2);
 	}
 	
-	if(first == QLatin1Char('.') && m_src.peek().isDigit())
+	if(first == Latin1('.') && CharClass::isDigit(m_src.peek()))
 		return readFloatNumber();
 	
-	if(first == QLatin1Char('\'') || first == QLatin1Char('"'))
+	if(first == Latin1('\'') || first == Latin1('"'))
 		return readStringLiteral(first);
 	
-	if(first.isLetter() || (first == QLatin1Char('_')))
+	if(CharClass::isIdentifierStart(first))
 		return readIdentifier();
 	
-	if(first.isDigit())
+	if(CharClass::isDigit(first))
 		return readNumber();
 	
-	if(first == QLatin1Char('-') && m_src.peek() == QLatin1Char('-'))
+	if(first == Latin1('-') && m_src.peek() == Latin1('-'))
 	{
 		m_src.move();
-		if(m_src.peek() == QLatin1Char('['))
+		if(m_src.peek() == Latin1('['))
 		{
 			int count = 0;
-			while(m_src.peek(count+1) == QLatin1Char('='))
+			while(m_src.peek(count+1) == Latin1('='))
 				++count;
-			if(m_src.peek(count+1) == QLatin1Char('['))
+			if(m_src.peek(count+1) == Latin1('['))
 			{
 				m_src.move(count+2);
 				return readMultiLineComment(count);
@@ -209,41 +204,45 @@ FormatToken Scanner::onDefaultState()
 		return readComment();
 	}
 	
-	if(first == QLatin1Char('['))
+	if(first == Latin1('['))
 	{
 		int count = 0;
-		while(m_src.peek(count) == QLatin1Char('='))
+		while(m_src.peek(count) == Latin1('='))
 			++count;
-		if(m_src.peek(count) == QLatin1Char('['))
+		if(m_src.peek(count) == Latin1('['))
 		{
 			m_src.move(count+1);
 			return readMultiLineStringLiteral(count);
 		}
 	}
 	
-	if(first.isSpace())
+	if(CharClass::isSpace(first))
 		return readWhiteSpace();
 	
 	return readOperator();
 }
 
-void Scanner::checkEscapeSequence(QChar quoteChar)
+template<typename Char>
+void BasicScanner<Char>::checkEscapeSequence(Char quoteChar)
 {
-	if(m_src.peek() == QLatin1Char('\\')) {
+	if(m_src.peek() == Latin1('\\')) {
 		m_src.move();
-		QChar ch = m_src.peek();
-		if(ch == QLatin1Char('\n') || ch.isNull())
-			saveState(State_String, quoteChar);
+		Char ch = m_src.peek();
+		if(ch == Latin1('\n') || ch == Latin1('\0'))
+			saveState(State_String, CodeUnit<Char>::value(quoteChar));
 	}
 }
 
-FormatToken Scanner::readStringLiteral(QChar quoteChar)
+template<typename Char>
+FormatToken BasicScanner<Char>::readStringLiteral(Char quoteChar)
 {
-	QChar ch = m_src.peek();
+	m_src.skipToAny(quoteChar, Latin1('\\'), Latin1('\0'));
+	Char ch = m_src.peek();
 	
-	while(ch != quoteChar && !ch.isNull()) {
+	while(ch != quoteChar && ch != Latin1('\0')) {
 		checkEscapeSequence(quoteChar);
 		m_src.move();
+		m_src.skipToAny(quoteChar, Latin1('\\'), Latin1('\0'));
 		ch = m_src.peek();
 	}
 	if(ch == quoteChar)
@@ -252,25 +251,27 @@ FormatToken Scanner::readStringLiteral(QChar quoteChar)
 	return FormatToken(Format_String, m_src.anchor(), m_src.length());
 }
 
-FormatToken Scanner::readMultiLineStringLiteral(int literalId)
+template<typename Char>
+FormatToken BasicScanner<Char>::readMultiLineStringLiteral(int literalId)
 {
-	saveState(State_MultiLineString, QChar(static_cast<ushort>(literalId)));
+	saveState(State_MultiLineString, static_cast<ushort>(literalId));
 	for(;;) {
-		QChar ch = m_src.peek();
-		if(ch.isNull())
+		m_src.skipToAny(Latin1(']'), Latin1('\0'), Latin1('\0'));
+		Char ch = m_src.peek();
+		if(ch == Latin1('\0'))
 			break;
-		if(ch == QLatin1Char(']'))
+		if(ch == Latin1(']'))
 		{
 			bool bMatching = true;
 			for(int i = 0; i < literalId; ++i)
 			{
-				if(m_src.peek(i+1) != QLatin1Char('='))
+				if(m_src.peek(i+1) != Latin1('='))
 				{
 					bMatching = false;
 					break;
 				}
 			}
-			if(bMatching && m_src.peek(literalId+1) == QLatin1Char(']'))
+			if(bMatching && m_src.peek(literalId+1) == Latin1(']'))
 			{
 				clearState();
 				m_src.move(literalId+2);
@@ -283,76 +284,63 @@ FormatToken Scanner::readMultiLineStringLiteral(int literalId)
 	return FormatToken(Format_String, m_src.anchor(), m_src.length());
 }
 
-FormatToken Scanner::readIdentifier()
+template<typename Char>
+FormatToken BasicScanner<Char>::readIdentifier()
 {
-	QChar ch = m_src.peek();
-	while(ch.isLetterOrNumber() || (ch == QLatin1Char('_'))) {
+	Char ch = m_src.peek();
+	while(CharClass::isIdentifierChar(ch)) {
 		m_src.move();
 		ch = m_src.peek();
 	}
 	
-	QString value = m_src.value();
+	Keyword keyword;
+	Format tkFormat = classifyIdentifier(m_src.data(), m_src.length(), keyword);
 	
-	Format tkFormat = Format_Identifier;
-	for(auto it = g_pairs.begin(); it != g_pairs.end(); ++it)
-	{
-		if(it.value().contains(value))
-		{
-			tkFormat = it.key();
-			break;
-		}
-	}
-	
-	return FormatToken(tkFormat, m_src.anchor(), m_src.length());
-}
-
-inline static bool isHexDigit(QChar ch)
-{
-    return (ch.isDigit()
-		|| (ch >= QLatin1Char('a') && ch <= QLatin1Char('f'))
-		|| (ch >= QLatin1Char('A') && ch <= QLatin1Char('F')));
+	return FormatToken(tkFormat, m_src.anchor(), m_src.length(), keyword);
 }
 
-FormatToken Scanner::readNumber()
+template<typename Char>
+FormatToken BasicScanner<Char>::readNumber()
 {
 	if(!m_src.isEnd()) {
-		if(m_src.peek().toLower() == QLatin1Char('x'))
+		if((m_src.peek() == Latin1('x') || m_src.peek() == Latin1('X')))
 		{
 			m_src.move();
-			while(isHexDigit(m_src.peek()))
+			while(CharClass::isHexDigit(m_src.peek()))
 				m_src.move();
-			if(m_src.peek() == QLatin1Char('.'))
+			if(m_src.peek() == Latin1('.'))
 			{
 				m_src.move();
-				while(isHexDigit(m_src.peek()))
+				while(CharClass::isHexDigit(m_src.peek()))
 					m_src.move();
 			}
-			if(m_src.peek().toLower() == QLatin1Char('p'))
+			if((m_src.peek() == Latin1('p') || m_src.peek() == Latin1('P')))
 			{
 				m_src.move();
-				if( (m_src.peek() == QLatin1Char('+')) || (m_src.peek() == QLatin1Char('-')))
+				if( (m_src.peek() == Latin1('+')) || (m_src.peek() == Latin1('-')))
 					m_src.move();
-				while(m_src.peek().isDigit())
+				while(CharClass::isDigit(m_src.peek()))
 					m_src.move();
 			}
 		}
-		else if(m_src.peek() == QLatin1Char('.') || m_src.peek().isDigit())
+		else if(m_src.peek() == Latin1('.') || CharClass::isDigit(m_src.peek()))
 			return readFloatNumber();
 	}
 	return FormatToken(Format_Number, m_src.anchor(), m_src.length());
 }
 
-FormatToken Scanner::readFloatNumber()
+template<typename Char>
+FormatToken BasicScanner<Char>::readFloatNumber()
 {
 	if(!m_src.isEnd()) {
 		bool hasDot = false;
 		bool hasExp = false;
 		for(;;) {
-			QChar ch = m_src.peek();
-			if(ch.isNull())
+			Char ch = m_src.peek();
+			if(ch == Latin1('\0'))
 				break;
 			
-			if(ch == QLatin1Char('.'))
+			if(ch == Latin1('.'))
 			{
 				if(hasDot)
 					break;
@@ -360,17 +348,17 @@ FormatToken Scanner::readFloatNumber()
 				hasDot = true;
 				continue;
 			}
-			else if(ch == QLatin1Char('e'))
+			else if(ch == Latin1('e'))
 			{
 				if(hasExp)
 					break;
 				m_src.move();
-				if(m_src.peek() == QLatin1Char('-'))
+				if(m_src.peek() == Latin1('-'))
 					m_src.move();
 				hasExp = true;
 				continue;
 			}
-			else if(!ch.isDigit())
+			else if(!CharClass::isDigit(ch))
 				break;
 			m_src.move();
 		}
@@ -379,35 +367,34 @@ FormatToken Scanner::readFloatNumber()
 	return FormatToken(Format_Number, m_src.anchor(), m_src.length());
 }
 
-FormatToken Scanner::readComment()
+template<typename Char>
+FormatToken BasicScanner<Char>::readComment()
 {
-	QChar ch = m_src.peek();
-	while(ch != QLatin1Char('\n') && !ch.isNull()) {
-		m_src.move();
-		ch = m_src.peek();
-	}
+	m_src.skipToAny(Latin1('\n'), Latin1('\0'), Latin1('\0'));
 	return FormatToken(Format_Comment, m_src.anchor(), m_src.length());
 }
 
-FormatToken Scanner::readMultiLineComment(int literalId)
+template<typename Char>
+FormatToken BasicScanner<Char>::readMultiLineComment(int literalId)
 {
-	saveState(State_MultiLineComment, QChar(static_cast<ushort>(literalId)));
+	saveState(State_MultiLineComment, static_cast<ushort>(literalId));
 	for(;;) {
-		QChar ch = m_src.peek();
-		if(ch.isNull())
+		m_src.skipToAny(Latin1(']'), Latin1('\0'), Latin1('\0'));
+		Char ch = m_src.peek();
+		if(ch == Latin1('\0'))
 			break;
-		if(ch == QLatin1Char(']'))
+		if(ch == Latin1(']'))
 		{
 			bool bMatching = true;
 			for(int i=0; i < literalId; ++i)
 			{
-				if(m_src.peek(i+1) != QLatin1Char('='))
+				if(m_src.peek(i+1) != Latin1('='))
 				{
 					bMatching = false;
 					break;
 				}
 			}
-			if(bMatching && m_src.peek(literalId+1) == QLatin1Char(']'))
+			if(bMatching && m_src.peek(literalId+1) == Latin1(']'))
 			{
 				clearState();
 				m_src.move(literalId+2);
@@ -419,19 +406,20 @@ FormatToken Scanner::readMultiLineComment(int literalId)
 	return FormatToken(Format_MLComment, m_src.anchor(), m_src.length());
 }
 
-FormatToken Scanner::readWhiteSpace()
+template<typename Char>
+FormatToken BasicScanner<Char>::readWhiteSpace()
 {
-	while(m_src.peek().isSpace())
+	while(CharClass::isSpace(m_src.peek()))
 		m_src.move();
 	return FormatToken(Format_Whitespace, m_src.anchor(), m_src.length());
 }
 
-FormatToken Scanner::readOperator()
+template<typename Char>
+FormatToken BasicScanner<Char>::readOperator()
 {
-	QString const EXCLUDED_CHARS = QLatin1String("\"'_");
-	QChar ch = m_src.peek();
-	while(ch.isPunct() && !EXCLUDED_CHARS.contains(ch)) {
-		if(ch == QLatin1Char('-') && m_src.peek(1) == QLatin1Char('-'))
+	Char ch = m_src.peek();
+	while(CharClass::isOperator(ch)) {
+		if(ch == Latin1('-') && m_src.peek(1) == Latin1('-'))
 			break;
 		m_src.move();
 		ch = m_src.peek();
@@ -439,17 +427,101 @@ FormatToken Scanner::readOperator()
 	return FormatToken(Format_Operator, m_src.anchor(), m_src.length());
 }
 
-void Scanner::clearState() { m_state = 0; }
-void Scanner::saveState(State state, QChar savedData)
+template<typename Char>
+void BasicScanner<Char>::clearState() { m_state = 0; }
+template<typename Char>
+void BasicScanner<Char>::saveState(State state, ushort savedData)
 {
-	m_state = (state << 16) | static_cast<int>(savedData.unicode());
+	m_state = (state << 16) | static_cast<int>(savedData);
 }
-void Scanner::parseState(State &state, QChar &savedData) const
+template<typename Char>
+void BasicScanner<Char>::parseState(State &state, ushort &savedData) const
 {
 	state = static_cast<State>(m_state >> 16);
 	savedData = static_cast<ushort>(m_state);
 }
 
+template<typename Char>
+void BasicScanner<Char>::tokenize(Char const* text, int length, int initialState, TokenBuffer& buffer)
+{
+	buffer.clear();
+	
+	int state = initialState;
+	int lineBegin = 0;
+	for(;;)
+	{
+		int lineEnd = ScanKernels::findFirstOf(CodeUnit<Char>::units(text), lineBegin, length,
+											   '\n', '\n', '\n');
+		
+		BasicScanner scanner(text + lineBegin, lineEnd - lineBegin);
+		scanner.setState(state);
+		buffer.beginLine(lineBegin);
+		
+		FormatToken tk;
+		while((tk = scanner.read()).format() != Format_EndOfBlock)
+		{
+			// an embedded NUL stops long brackets without consuming anything
+			if(tk.length() == 0)
+				break;
+			buffer.append(tk.format(), tk.keyword(), lineBegin + static_cast<int>(tk.begin()), static_cast<int>(tk.length()));
+		}
+		
+		state = scanner.state();
+		buffer.endLine(state);
+		
+		if(lineEnd >= length)
+			break;
+		lineBegin = lineEnd + 1;
+	}
+}
+
+template class BasicScanner<QChar>;
+template class BasicScanner<char>;
+
+void Scanner::tokenize(QString const& text, int initialState, TokenBuffer& buffer)
+{
+	tokenize(text.constData(), text.size(), initialState, buffer);
+}
+
+ScannerBase::TokType ScannerBase::tokenTypeAt(TokenBuffer const& tokens, int initialState, int offset)
+{
+	int line = tokens.lineAt(offset);
+	int firstToken = tokens.lineFirstToken(line);
+	int lastToken = tokens.lineFirstToken(line+1) - 1;
+	
+	// the token holding the character left of offset
+	int index = tokens.tokenBefore(offset);
+	
+	int state;
+	if(index < firstToken)
+		state = line == 0 ? initialState : tokens.lineEndState(line-1);
+	else
+	{
+		Format format = tokens.format(index);
+		if(format == Format_Comment)
+			return TT_Comment;
+		if(format != Format_String && format != Format_MLComment)
+			return TT_Code;
+		if(offset < tokens.end(index))
+			return format == Format_String ? TT_String : TT_Comment;
+		// an unterminated literal continues past the end of the line
+		if(index != lastToken)
+			return TT_Code;
+		state = tokens.lineEndState(line);
+	}
+	
+	switch(static_cast<State>(state >> 16))
+	{
+	case State_String:
+	case State_MultiLineString:
+		return TT_String;
+	case State_MultiLineComment:
+		return TT_Comment;
+	default:
+		return TT_Code;
+	}
+}
+
 void Scanner::TakeBackwardsMember(QTextBlock block, RecursiveClassMembers &targetIdentifier)
 {
 	QString str = block.text();
@@ -476,8 +548,33 @@ void Scanner::TakeBackwardsMember(QTextBlock block, RecursiveClassMembers &targe
 	}
 }
 
+int Scanner::StateAfterBlock(QTextBlock block)
+{
+	QList<QTextBlock> blockList;
+	
+	while(block.isValid() && block.userState() == -1)
+	{
+		blockList.push_front(block);
+		block = block.previous();
+	}
+	
+	int state = block.isValid() ? block.userState() : 0;
+	for(auto it = blockList.begin(); it != blockList.end(); ++it)
+	{
+		QString str = it->text();
+		Scanner scanner(str.constData(),str.size());
+		scanner.setState(state);
+		while(scanner.read().format() != Format_EndOfBlock) {}
+		state = scanner.state();
+	}
+	return state;
+}
+
 int Scanner::TakeBackwardsState(QTextBlock block, RecursiveClassMembers* targetIdentifiers)
 {
+	if(!targetIdentifiers)
+		return StateAfterBlock(block);
+	
 	QList<QTextBlock> blockList;
 	
 	while(block.isValid())
@@ -489,37 +586,14 @@ int Scanner::TakeBackwardsState(QTextBlock block, RecursiveClassMembers* targetI
 	int state = 0;
 	for(auto it = blockList.begin(); it != blockList.end(); ++it)
 	{
-		QTextBlock const& bk = *it;
-		QString str = bk.text();
-		Scanner scanner(str.constData(),str.size());
-		scanner.setState(state);
-		
-		FormatToken tk;
-		RecursiveClassMembers* lastClassMember = nullptr;
-		
-		while((tk=scanner.read()).format() != Format_EndOfBlock)
+		LuaBlockData const* data = LuaBlockData::get(*it, state);
+		for(QStringList const& chain : data->m_identifiers)
 		{
-			if(!targetIdentifiers)
-				continue;
-			
-			switch(tk.format())
-			{
-			case Format_Identifier:
-				if(!lastClassMember)
-					lastClassMember = targetIdentifiers;
-				lastClassMember = &(*lastClassMember)[scanner.value(tk)];
-				break;
-			case Format_Operator:
-				{
-					if(scanner.value(tk) != QLatin1String("."))
-						lastClassMember = nullptr;
-				}
-				break;
-			default:
-				break;
-			}
+			RecursiveClassMembers* lastClassMember = targetIdentifiers;
+			for(QString const& identifier : chain)
+				lastClassMember = &(*lastClassMember)[identifier];
 		}
-		state = scanner.state();
+		state = data->m_endState;
 	}
 	return state;
 }
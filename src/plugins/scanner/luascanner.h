@@ -17,6 +17,7 @@
 #include "../luaeditor_global.h"
 #include "luaformattoken.h"
 #include "sourcecodestream.h"
+#include "luatokenbuffer.h"
 #include "recursiveclassmembers.h"
 #include "../luaengine/luaengine.h"
 #include <QTextBlock>
@@ -25,10 +26,8 @@
 
 namespace LuaEditor { namespace Internal {
 
-class Scanner
+class ScannerBase
 {
-	Scanner(Scanner const&) =delete;
-	Scanner& operator= (Scanner const&) =delete;
 public:
 	enum TokType {
 		TT_Code					=0x00000000,
@@ -43,21 +42,37 @@ public:
 		State_MultiLineComment	=0x00000003
 	};
 	
-	Scanner(QChar const* text, int const length);
+	// Type of the text left of offset, found by binary search over tokens as
+	// filled by tokenize() with initialState. Unterminated strings and comments
+	// continue to the end of their line.
+	static TokType tokenTypeAt(TokenBuffer const& tokens, int initialState, int offset);
+};
+
+// The scanner works on QChar (UTF-16, the editor's documents) as well as on
+// char (UTF-8, files read from disk); offsets are in code units of Char.
+template<typename Char>
+class BasicScanner : public ScannerBase
+{
+	BasicScanner(BasicScanner const&) =delete;
+	BasicScanner& operator= (BasicScanner const&) =delete;
+	
+	typedef typename CodeUnit<Char>::Latin1 Latin1;
+public:
+	BasicScanner(Char const* text, int const length);
 	
 	void setState(int);
 	int state() const;
 	FormatToken read();
 	QString value(FormatToken const& tk) const;
-	TokType tokenTypeAt(int offset);
 	
-	static void TakeBackwardsMember(QTextBlock block, RecursiveClassMembers& targetIdentifier);
-	static int TakeBackwardsState(QTextBlock block, RecursiveClassMembers* targetIdentifiers =nullptr);
+	// Tokenizes text line by line, starting in initialState, into buffer.
+	// Lines are separated by '\n' and scanned exactly like single blocks.
+	static void tokenize(Char const* text, int length, int initialState, TokenBuffer& buffer);
 private:
 	FormatToken onDefaultState();
 	
-	void checkEscapeSequence(QChar quoteChar);
-	FormatToken readStringLiteral(QChar quoteChar);
+	void checkEscapeSequence(Char quoteChar);
+	FormatToken readStringLiteral(Char quoteChar);
 	FormatToken readMultiLineStringLiteral(int literalId);
 	FormatToken readIdentifier();
 	FormatToken readNumber();
@@ -68,13 +83,35 @@ private:
 	FormatToken readOperator();
 	
 	void clearState();
-	void saveState(State state, QChar savedData);
-	void parseState(State& state, QChar& savedData) const;
+	void saveState(State state, ushort savedData);
+	void parseState(State& state, ushort& savedData) const;
 	
-	SourceCodeStream m_src;
+	BasicSourceCodeStream<Char> m_src;
 	int m_state;
 };
 
+extern template class BasicScanner<QChar>;
+extern template class BasicScanner<char>;
+
+typedef BasicScanner<char> Utf8Scanner;
+
+class Scanner : public BasicScanner<QChar>
+{
+public:
+	using BasicScanner<QChar>::BasicScanner;
+	using BasicScanner<QChar>::tokenize;
+	
+	static void tokenize(QString const& text, int initialState, TokenBuffer& buffer);
+	
+	static void TakeBackwardsMember(QTextBlock block, RecursiveClassMembers& targetIdentifier);
+	static int TakeBackwardsState(QTextBlock block, RecursiveClassMembers* targetIdentifiers =nullptr);
+	
+	// Scanner state at the end of block, read from the state LuaHighlighter stored
+	// in QTextBlock::userState(). Only blocks the highlighter hasn't reached yet
+	// (userState() == -1) are re-scanned, starting at the closest highlighted one.
+	static int StateAfterBlock(QTextBlock block);
+};
+
 } }
 
 #endif // LUASCANNER_H
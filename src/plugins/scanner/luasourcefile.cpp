@@ -0,0 +1,86 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#include "luasourcefile.h"
+#include "luascanner.h"
+#include <cstring>
+#include <limits>
+
+namespace LuaEditor { namespace Internal {
+
+SourceFile::SourceFile()
+	: m_map(nullptr),
+	  m_data(nullptr),
+	  m_size(0) {}
+
+SourceFile::~SourceFile()
+{
+	if(m_map)
+		m_file.unmap(m_map);
+}
+
+bool SourceFile::open(QString const& path)
+{
+	m_file.setFileName(path);
+	bool readable = m_file.open(QIODevice::ReadOnly);
+	if(readable && m_file.size() > 0 && m_file.size() <= std::numeric_limits<int>::max())
+	{
+		m_map = m_file.map(0, m_file.size());
+		if(m_map)
+		{
+			m_data = reinterpret_cast<char const*>(m_map);
+			m_size = static_cast<int>(m_file.size());
+		}
+	}
+	// files that can't be mapped, e.g. on some network file systems
+	if(readable && !m_map)
+	{
+		m_content = m_file.readAll();
+		m_data = m_content.constData();
+		m_size = m_content.size();
+	}
+	
+	// skip the UTF-8 byte order mark
+	if(m_size >= 3 && std::memcmp(m_data, "\xEF\xBB\xBF", 3) == 0)
+	{
+		m_data += 3;
+		m_size -= 3;
+	}
+	
+	Utf8Scanner::tokenize(m_data, m_size, 0, m_tokens);
+	return readable;
+}
+
+QString SourceFile::text(int token) const
+{
+	return QString::fromUtf8(m_data + m_tokens.begin(token), qMin(m_tokens.length(token), m_size - m_tokens.begin(token)));
+}
+
+QString SourceFile::line(int line) const
+{
+	int begin = m_tokens.lineOffset(line);
+	int end = line+1 < lineCount() ? m_tokens.lineOffset(line+1) - 1 : m_size;
+	if(end > begin && m_data[end-1] == '\r')
+		--end;
+	return QString::fromUtf8(m_data + begin, end - begin);
+}
+
+bool SourceFile::tokenEquals(int token, QLatin1String text) const
+{
+	// unterminated strings may end past the end of the file
+	return m_tokens.length(token) == text.size() && m_tokens.end(token) <= m_size
+		&& std::memcmp(m_data + m_tokens.begin(token), text.data(), static_cast<size_t>(text.size())) == 0;
+}
+
+} }
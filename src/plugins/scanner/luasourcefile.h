@@ -0,0 +1,61 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUASOURCEFILE_H
+#define LUASOURCEFILE_H
+#include "../luaeditor_global.h"
+#include "luatokenbuffer.h"
+#include <QByteArray>
+#include <QFile>
+#include <QLatin1String>
+#include <QString>
+
+namespace LuaEditor { namespace Internal {
+
+// A Lua file read from disk for indexing. The file is memory mapped when
+// possible and tokenized in place as UTF-8, so neither a UTF-16 copy of the
+// whole file nor a QString per line is built; offsets are byte offsets.
+class SourceFile
+{
+	SourceFile(SourceFile const&) =delete;
+	SourceFile& operator= (SourceFile const&) =delete;
+public:
+	SourceFile();
+	~SourceFile();
+	
+	// returns false if the file can't be read, the source is empty then
+	bool open(QString const& path);
+	
+	inline char const* data() const { return m_data; }
+	inline int size() const { return m_size; }
+	inline TokenBuffer const& tokens() const { return m_tokens; }
+	inline int lineCount() const { return m_tokens.lineCount(); }
+	// 1-based line number of offset
+	inline int lineNumber(int offset) const { return m_tokens.lineAt(offset) + 1; }
+	
+	QString text(int token) const;
+	// text of line without the line break
+	QString line(int line) const;
+	bool tokenEquals(int token, QLatin1String text) const;
+private:
+	QFile m_file;
+	uchar* m_map;
+	QByteArray m_content;
+	char const* m_data;
+	int m_size;
+	TokenBuffer m_tokens;
+};
+
+} }
+#endif // LUASOURCEFILE_H
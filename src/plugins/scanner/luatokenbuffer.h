@@ -0,0 +1,133 @@
+/*	Copyright (c) 2015 SGH
+**	
+**	Permission is granted to use, modify and redistribute this software.
+**	Modified versions of this software MUST be marked as such.
+**	
+**	This software is provided "AS IS". In no event shall
+**	the authors or copyright holders be liable for any claim,
+**	damages or other liability. The above copyright notice
+**	and this permission notice shall be included in all copies
+**	or substantial portions of the software.
+**	
+**	File created on: 17/10/2026
+*/
+
+#ifndef LUATOKENBUFFER_H
+#define LUATOKENBUFFER_H
+#include "../luaeditor_global.h"
+#include "luaformattoken.h"
+#include <QVector>
+#include <algorithm>
+
+namespace LuaEditor { namespace Internal {
+
+// Tokens of a whole text as parallel arrays, filled by Scanner::tokenize().
+// Offsets are relative to the start of the tokenized text; tokens longer
+// than 65535 code units are split into several tokens of the same format.
+// clear() keeps the capacity, so a buffer that is reused for texts of
+// similar size doesn't allocate anymore.
+class TokenBuffer
+{
+public:
+	enum { MaxTokenLength = 0xFFFF };
+
+	inline void clear()
+	{
+		m_offsets.clear();
+		m_lengths.clear();
+		m_formats.clear();
+		m_keywords.clear();
+		m_lineOffsets.clear();
+		m_lineTokens.clear();
+		m_lineStates.clear();
+	}
+
+	inline int size() const { return m_offsets.size(); }
+	inline bool isEmpty() const { return m_offsets.isEmpty(); }
+	inline int begin(int token) const { return static_cast<int>(m_offsets.at(token)); }
+	inline int end(int token) const { return begin(token) + length(token); }
+	inline int length(int token) const { return m_lengths.at(token); }
+	inline Format format(int token) const { return static_cast<Format>(m_formats.at(token)); }
+	inline Keyword keyword(int token) const { return static_cast<Keyword>(m_keywords.at(token)); }
+
+	inline int lineCount() const { return m_lineOffsets.size(); }
+	inline int lineOffset(int line) const { return static_cast<int>(m_lineOffsets.at(line)); }
+	// tokens of line are [lineFirstToken(line), lineFirstToken(line+1))
+	inline int lineFirstToken(int line) const { return line < lineCount() ? static_cast<int>(m_lineTokens.at(line)) : size(); }
+	// scanner state at the end of line
+	inline int lineEndState(int line) const { return m_lineStates.at(line); }
+
+	// index of the last token beginning before offset, -1 if there is none
+	inline int tokenBefore(int offset) const
+	{
+		auto it = std::lower_bound(m_offsets.constBegin(), m_offsets.constEnd(), static_cast<quint32>(qMax(offset, 0)));
+		return static_cast<int>(it - m_offsets.constBegin()) - 1;
+	}
+	// index of the line containing offset
+	inline int lineAt(int offset) const
+	{
+		auto it = std::upper_bound(m_lineOffsets.constBegin(), m_lineOffsets.constEnd(), static_cast<quint32>(qMax(offset, 0)));
+		return qMax(0, static_cast<int>(it - m_lineOffsets.constBegin()) - 1);
+	}
+
+	inline void beginLine(int offset)
+	{
+		m_lineOffsets.push_back(static_cast<quint32>(offset));
+		m_lineTokens.push_back(static_cast<quint32>(size()));
+	}
+	inline void endLine(int state) { m_lineStates.push_back(state); }
+	// replaces the contents with line of other, moved to offset 0
+	inline void assignLine(TokenBuffer const& other, int line)
+	{
+		clear();
+		int offset = other.lineOffset(line);
+		beginLine(0);
+		for(int i = other.lineFirstToken(line); i < other.lineFirstToken(line+1); ++i)
+			appendToken(other, i, -offset);
+		endLine(other.lineEndState(line));
+	}
+	// appends the lines of other from firstLine on, keeping their offsets
+	inline void appendLines(TokenBuffer const& other, int firstLine)
+	{
+		for(int line = firstLine; line < other.lineCount(); ++line)
+		{
+			beginLine(other.lineOffset(line));
+			for(int i = other.lineFirstToken(line); i < other.lineFirstToken(line+1); ++i)
+				appendToken(other, i, 0);
+			endLine(other.lineEndState(line));
+		}
+	}
+	inline void append(Format format, Keyword keyword, int offset, int length)
+	{
+		do {
+			int part = qMin<int>(length, MaxTokenLength);
+			m_offsets.push_back(static_cast<quint32>(offset));
+			m_lengths.push_back(static_cast<quint16>(part));
+			m_formats.push_back(static_cast<quint8>(format));
+			m_keywords.push_back(static_cast<quint8>(keyword));
+			offset += part;
+			length -= part;
+		} while(length > 0);
+	}
+
+private:
+	inline void appendToken(TokenBuffer const& other, int token, int offsetDelta)
+	{
+		m_offsets.push_back(static_cast<quint32>(other.begin(token) + offsetDelta));
+		m_lengths.push_back(other.m_lengths.at(token));
+		m_formats.push_back(other.m_formats.at(token));
+		m_keywords.push_back(other.m_keywords.at(token));
+	}
+
+	QVector<quint32> m_offsets;
+	QVector<quint16> m_lengths;
+	QVector<quint8> m_formats;
+	QVector<quint8> m_keywords;
+
+	QVector<quint32> m_lineOffsets;
+	QVector<quint32> m_lineTokens;
+	QVector<int> m_lineStates;
+};
+
+} }
+#endif // LUATOKENBUFFER_H
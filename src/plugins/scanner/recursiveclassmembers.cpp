@@ -13,13 +13,57 @@
 */
 
 #include "recursiveclassmembers.h"
+#include <QHash>
+#include <deque>
+#include <vector>
 
 namespace LuaEditor { namespace Internal {
 
+struct RecursiveClassMembers::Tree
+{
+	// a deque never moves its elements, the nodes stay where they are
+	std::deque<RecursiveClassMembers> nodes;
+	// open addressing over all nodes, a power of two in size
+	std::vector<RecursiveClassMembers*> slots;
+	
+	static uint hash(RecursiveClassMembers const* parent, QString const& name)
+	{
+		return qHash(name, qHash(reinterpret_cast<quintptr>(parent)));
+	}
+	
+	void insert(RecursiveClassMembers* node)
+	{
+		size_t mask = slots.size() - 1;
+		size_t i = hash(node->mparent, node->parentName) & mask;
+		while(slots[i])
+			i = (i + 1) & mask;
+		slots[i] = node;
+	}
+	
+	void grow()
+	{
+		// keeps the table at most half full
+		if((nodes.size() + 1) * 2 <= slots.size())
+			return;
+		slots.assign(qMax<size_t>(64, slots.size() * 2), nullptr);
+		for(RecursiveClassMembers& node : nodes)
+		{
+			if(!node.mremoved)
+				insert(&node);
+		}
+	}
+};
+
 RecursiveClassMembers::RecursiveClassMembers(QString const& name, RecursiveClassMembers* parent)
-	: parentName(name), mparent(parent) {}
+	: parentName(name), mparent(parent), mfirstChild(nullptr), mnextSibling(nullptr), mremoved(false),
+	  mtree(parent ? parent->mtree : new Tree) {}
 RecursiveClassMembers::RecursiveClassMembers()
-	: mparent(nullptr) {}
+	: mparent(nullptr), mfirstChild(nullptr), mnextSibling(nullptr), mremoved(false), mtree(new Tree) {}
+RecursiveClassMembers::~RecursiveClassMembers()
+{
+	if(!mparent)
+		delete mtree;
+}
 
 QStringList RecursiveClassMembers::buildDirectory() const
 {
@@ -64,49 +108,84 @@ RecursiveClassMembers* RecursiveClassMembers::matchesChilds(QStringList matchRec
 }
 RecursiveClassMembers const* RecursiveClassMembers::parent() const { return mparent; }
 RecursiveClassMembers* RecursiveClassMembers::parent() { return mparent; }
-void RecursiveClassMembers::clear() { childs.clear(); }
-RecursiveClassMembers::iterator RecursiveClassMembers::begin() { return childs.begin(); }
-RecursiveClassMembers::const_iterator RecursiveClassMembers::begin() const { return childs.begin(); }
-RecursiveClassMembers::const_iterator RecursiveClassMembers::cbegin() const { return childs.cbegin(); }
-RecursiveClassMembers::iterator RecursiveClassMembers::end() { return childs.end(); }
-RecursiveClassMembers::const_iterator RecursiveClassMembers::end() const { return childs.end(); }
-RecursiveClassMembers::const_iterator RecursiveClassMembers::cend() const { return childs.cend(); }
+void RecursiveClassMembers::clear()
+{
+	if(!mparent)
+	{
+		// frees the whole tree
+		mfirstChild = nullptr;
+		mtree->nodes.clear();
+		mtree->slots.clear();
+		return;
+	}
+	removeChildren();
+}
+void RecursiveClassMembers::removeChildren()
+{
+	for(RecursiveClassMembers* child = mfirstChild; child; child = child->mnextSibling)
+		child->mremoved = true;
+	mfirstChild = nullptr;
+}
+RecursiveClassMembers::iterator RecursiveClassMembers::begin() { return iterator(mfirstChild); }
+RecursiveClassMembers::const_iterator RecursiveClassMembers::begin() const { return const_iterator(mfirstChild); }
+RecursiveClassMembers::const_iterator RecursiveClassMembers::cbegin() const { return const_iterator(mfirstChild); }
+RecursiveClassMembers::iterator RecursiveClassMembers::end() { return iterator(); }
+RecursiveClassMembers::const_iterator RecursiveClassMembers::end() const { return const_iterator(); }
+RecursiveClassMembers::const_iterator RecursiveClassMembers::cend() const { return const_iterator(); }
 QString const& RecursiveClassMembers::key() const { return parentName; }
 
+RecursiveClassMembers* RecursiveClassMembers::findChild(QString const& childName) const
+{
+	std::vector<RecursiveClassMembers*> const& slots = mtree->slots;
+	if(slots.empty())
+		return nullptr;
+	
+	size_t mask = slots.size() - 1;
+	for(size_t i = Tree::hash(this, childName) & mask; slots[i]; i = (i + 1) & mask)
+	{
+		RecursiveClassMembers* node = slots[i];
+		if(node->mparent == this && !node->mremoved && node->parentName == childName)
+			return node;
+	}
+	return nullptr;
+}
+
 RecursiveClassMembers& RecursiveClassMembers::operator [](QString const& childName)
 {
-	iterator k = find(childName);
-	if(k != end())
-		return *k;
-	childs.emplace_front(childName,this);
-	return childs.front();
+	if(RecursiveClassMembers* child = findChild(childName))
+		return *child;
+	
+	mtree->grow();
+	mtree->nodes.emplace_back(childName, this);
+	RecursiveClassMembers* child = &mtree->nodes.back();
+	mtree->insert(child);
+	
+	child->mnextSibling = mfirstChild;
+	mfirstChild = child;
+	return *child;
 }
 
 void RecursiveClassMembers::removeChild(const QString &childName)
 {
-	const_iterator k = find(childName);
-	if(k != end())
-		childs.erase(k);
+	for(RecursiveClassMembers** link = &mfirstChild; *link; link = &(*link)->mnextSibling)
+	{
+		if((*link)->parentName == childName)
+		{
+			(*link)->mremoved = true;
+			*link = (*link)->mnextSibling;
+			return;
+		}
+	}
 }
 
 RecursiveClassMembers::iterator RecursiveClassMembers::find(QString const& childName)
 {
-	for(iterator it = childs.begin(); it != childs.end(); ++it)
-	{
-		if(it->key() == childName)
-			return it;
-	}
-	return childs.end();
+	return iterator(findChild(childName));
 }
 
 RecursiveClassMembers::const_iterator RecursiveClassMembers::find(QString const& childName) const
 {
-	for(const_iterator it = childs.cbegin(); it != childs.cend(); ++it)
-	{
-		if(it->key() == childName)
-			return it;
-	}
-	return childs.cend();
+	return const_iterator(findChild(childName));
 }
 
 } }
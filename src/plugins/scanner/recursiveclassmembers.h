@@ -15,23 +15,59 @@
 #ifndef RECURSIVECLASSMEMBERS_H
 #define RECURSIVECLASSMEMBERS_H
 #include "../luaeditor_global.h"
-#include <vector>
+#include <iterator>
 
 namespace LuaEditor { namespace Internal {
 
+// A tree of identifiers and their members. All nodes of a tree are
+// allocated by its root and freed with it at once; children are found by
+// a hash table of the tree keyed by parent and name, and iterate from the
+// newest to the oldest one.
 class RecursiveClassMembers {
-	typedef std::list<RecursiveClassMembers> value_type;
+	struct Tree;
+	
+	template<typename Node>
+	class Iterator
+	{
+		Node* m_node;
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Node value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef Node* pointer;
+		typedef Node& reference;
+		
+		explicit Iterator(Node* node =nullptr) : m_node(node) {}
+		inline Node& operator*() const { return *m_node; }
+		inline Node* operator->() const { return m_node; }
+		inline Iterator& operator++() { m_node = m_node->mnextSibling; return *this; }
+		inline Iterator operator++(int) { Iterator it = *this; ++*this; return it; }
+		inline bool operator==(Iterator const& other) const { return m_node == other.m_node; }
+		inline bool operator!=(Iterator const& other) const { return m_node != other.m_node; }
+		inline operator Iterator<Node const>() const { return Iterator<Node const>(m_node); }
+	};
+	
 	QString parentName;
-	value_type childs;
 	RecursiveClassMembers* mparent;
+	RecursiveClassMembers* mfirstChild;
+	RecursiveClassMembers* mnextSibling;
+	bool mremoved;
+	// owned by the root
+	Tree* mtree;
+	
+	RecursiveClassMembers(RecursiveClassMembers const&) =delete;
+	RecursiveClassMembers& operator= (RecursiveClassMembers const&) =delete;
 	
 	void logRecursive() const;
+	RecursiveClassMembers* findChild(QString const& childName) const;
+	void removeChildren();
 public:
-	typedef value_type::iterator iterator;
-	typedef value_type::const_iterator const_iterator;
+	typedef Iterator<RecursiveClassMembers> iterator;
+	typedef Iterator<RecursiveClassMembers const> const_iterator;
 	
 	RecursiveClassMembers();
 	RecursiveClassMembers(QString const& name, RecursiveClassMembers* parent);
+	~RecursiveClassMembers();
 	
 	QStringList buildDirectory() const;
 	RecursiveClassMembers* matchesChilds(QStringList matchRecursiveList);
@@ -15,14 +15,42 @@
 #ifndef SOURCECODESTREAM_H
 #define SOURCECODESTREAM_H
 #include "../luaeditor_global.h"
+#include "luascankernels.h"
 #include <QString>
 
 namespace LuaEditor { namespace Internal {
 
-class SourceCodeStream
+// What the scanner needs to know about a code unit type: QChar for UTF-16
+// text from the editor, char for UTF-8 files read from disk.
+template<typename Char> struct CodeUnit;
+
+template<> struct CodeUnit<QChar>
+{
+	typedef QLatin1Char Latin1;
+	typedef ushort Unit;
+	
+	static inline ushort value(QChar ch) { return ch.unicode(); }
+	static inline QChar fromValue(ushort value) { return QChar(value); }
+	static inline Unit const* units(QChar const* text) { return reinterpret_cast<ushort const*>(text); }
+	static inline QString toString(QChar const* text, int length) { return QString(text, length); }
+};
+
+template<> struct CodeUnit<char>
+{
+	typedef char Latin1;
+	typedef char Unit;
+	
+	static inline ushort value(char ch) { return static_cast<uchar>(ch); }
+	static inline char fromValue(ushort value) { return static_cast<char>(value); }
+	static inline Unit const* units(char const* text) { return text; }
+	static inline QString toString(char const* text, int length) { return QString::fromUtf8(text, length); }
+};
+
+template<typename Char>
+class BasicSourceCodeStream
 {
 public:
-	SourceCodeStream(QChar const* text, int const length) :
+	BasicSourceCodeStream(Char const* text, int const length) :
 		m_text(text),
 		m_textLength(length),
 		m_position(0),
@@ -34,27 +62,43 @@ public:
 	inline int length() const { return m_position - m_markedPosition; }
 	inline int anchor() const { return m_markedPosition; }
 	inline bool isEnd() const { return m_position >= m_textLength; }
-	inline QChar peek(int offset = 0) const
+	inline Char peek(int offset = 0) const
 	{
 		int pos = m_position + offset;
 		if(pos >= m_textLength)
-			return QLatin1Char('\0');
+			return Char();
 		return m_text[pos];
 	}
+	// moves to the next occurrence of a, b or c, or to the end of the text
+	inline void skipToAny(Char a, Char b, Char c)
+	{
+		if(m_position < m_textLength)
+			m_position = ScanKernels::findFirstOf(CodeUnit<Char>::units(m_text), m_position, m_textLength,
+												  unit(a), unit(b), unit(c));
+	}
+	inline Char const* data() const { return m_text + m_markedPosition; }
 	inline QString value() const
 	{
-		return QString(m_text + m_markedPosition, length());
+		return CodeUnit<Char>::toString(m_text + m_markedPosition, length());
 	}
 	inline QString value(int begin, int length) const
 	{
-		return QString(m_text + begin, length);
+		return CodeUnit<Char>::toString(m_text + begin, length);
 	}
 private:
-	QChar const* m_text;
+	static inline typename CodeUnit<Char>::Unit unit(Char ch)
+	{
+		return static_cast<typename CodeUnit<Char>::Unit>(CodeUnit<Char>::value(ch));
+	}
+	
+	Char const* m_text;
 	int m_textLength;
 	int m_position;
 	int m_markedPosition;
 };
 
+typedef BasicSourceCodeStream<QChar> SourceCodeStream;
+typedef BasicSourceCodeStream<char> Utf8SourceCodeStream;
+
 } }
 #endif // SOURCECODESTREAM_H